@@ -10,6 +10,33 @@
 #include <cctype>
 #include <fstream>
 #include <sstream>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+#include <csignal>
+#include <cstring>
+#include <random>
+#include <limits>
+#include <filesystem>
+#include <shared_mutex>
+#include <memory>
+#include <cmath>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
 using namespace std;
 
 // ======= Structs and Classes =======
@@ -37,6 +64,21 @@ private:
     MenuItem* head;
 public:
     Menu() : head(nullptr) {}
+    Menu(const Menu& other) : head(nullptr) { *this = other; }
+    Menu& operator=(const Menu& other) {
+        if (this == &other) return *this;
+        clear();
+        for (MenuItem* temp = other.head; temp; temp = temp->next) addItem(temp->name, temp->price);
+        return *this;
+    }
+    ~Menu() { clear(); }
+    void clear() {
+        while (head) {
+            MenuItem* next = head->next;
+            delete head;
+            head = next;
+        }
+    }
     void addItem(string n, double p) {
         MenuItem* newItem = new MenuItem(n, p);
         if (!head) head = newItem;
@@ -46,12 +88,13 @@ public:
             temp->next = newItem;
         }
     }
-    void display();
-    MenuItem* getItem(int idx);
-    double getAveragePrice();
+    void display() const;
+    MenuItem* getItem(int idx) const;
+    MenuItem* findItem(const string& itemName) const;
+    double getAveragePrice() const;
 };
 
-void Menu::display() {
+void Menu::display() const {
     MenuItem* temp = head;
     int idx = 1;
     bool discount = false; // simply for menu display, discount shown only in order placement
@@ -61,7 +104,7 @@ void Menu::display() {
         temp = temp->next;
     }
 }
-MenuItem* Menu::getItem(int idx) {
+MenuItem* Menu::getItem(int idx) const {
     MenuItem* temp = head;
     int count = 1;
     while (temp && count < idx) {
@@ -70,7 +113,12 @@ MenuItem* Menu::getItem(int idx) {
     }
     return temp;
 }
-double Menu::getAveragePrice() {
+MenuItem* Menu::findItem(const string& itemName) const {
+    MenuItem* temp = head;
+    while (temp && temp->name != itemName) temp = temp->next;
+    return temp;
+}
+double Menu::getAveragePrice() const {
     MenuItem* temp = head;
     double total = 0;
     int count = 0;
@@ -82,39 +130,91 @@ double Menu::getAveragePrice() {
     return count ? (total / count) : 0;
 }
 
-class Restaurant {
+// ======= Epoch-Based Reclamation =======
+// Readers announce the global epoch they entered in a per-thread slot; that is
+// two atomic stores, no locks. A retired snapshot is freed once every active
+// reader entered after it was retired.
+const int MAX_EPOCH_THREADS = 1024;
+atomic<unsigned long> globalEpoch{1};
+atomic<unsigned long> threadEpochs[MAX_EPOCH_THREADS]; // 0 = not reading
+atomic<bool> epochSlotUsed[MAX_EPOCH_THREADS];
+
+struct EpochSlot {
+    int idx = -1;
+    int depth = 0;
+    EpochSlot() {
+        for (int i = 0; i < MAX_EPOCH_THREADS && idx < 0; i++)
+            if (!epochSlotUsed[i].exchange(true)) idx = i;
+        if (idx < 0) {
+            cerr << "Too many threads reading the catalog\n";
+            abort();
+        }
+    }
+    ~EpochSlot() { epochSlotUsed[idx].store(false); }
+};
+thread_local EpochSlot epochSlot;
+
+// Pins every snapshot loaded while it is alive; nests within a thread
+class EpochGuard {
 public:
-    string name;
-    double rating;
-    map<string, Menu> categoryMenus;
-    Restaurant(string n, double r) : name(n), rating(r) {}
-    void addMenuItemToCategory(string category, string itemName, double price) {
-        categoryMenus[category].addItem(itemName, price);
+    EpochGuard() {
+        if (epochSlot.depth++ == 0) threadEpochs[epochSlot.idx].store(globalEpoch.load());
     }
-    void displayCategories();
-    void displayCategoryMenu(string category);
-    double getAveragePrice();
+    ~EpochGuard() {
+        if (--epochSlot.depth == 0) threadEpochs[epochSlot.idx].store(0);
+    }
+    EpochGuard(const EpochGuard&) = delete;
+    EpochGuard& operator=(const EpochGuard&) = delete;
+};
+
+// ======= Versioned Menu Catalog =======
+// A restaurant's menu is an immutable snapshot. Updates copy the current
+// snapshot, change the copy and publish it with one atomic store, so order
+// sessions keep pricing against the version they loaded.
+atomic<long> catalogVersion{1};
+
+struct MenuSnapshot {
+    long version;
+    map<string, Menu> categoryMenus;
+    const Menu* getMenu(const string& category) const;
+    void displayCategories() const;
+    void displayCategoryMenu(const string& category) const;
+    MenuItem* findItem(const string& itemName) const;
+    double getAveragePrice() const;
 };
 
-void Restaurant::displayCategories() {
+const Menu* MenuSnapshot::getMenu(const string& category) const {
+    auto it = categoryMenus.find(category);
+    return it != categoryMenus.end() ? &it->second : nullptr;
+}
+void MenuSnapshot::displayCategories() const {
     int idx = 1;
     for (auto& entry : categoryMenus) {
         cout << idx++ << ". " << entry.first << endl;
     }
 }
-void Restaurant::displayCategoryMenu(string category) {
-    if (categoryMenus.find(category) != categoryMenus.end()) {
+void MenuSnapshot::displayCategoryMenu(const string& category) const {
+    const Menu* menu = getMenu(category);
+    if (menu) {
         cout << category << " Menu:\n";
-        categoryMenus[category].display();
+        menu->display();
     } else {
         cout << "No such category found.\n";
     }
 }
-double Restaurant::getAveragePrice() {
+// Look an item up by name across all categories (used by the socket server)
+MenuItem* MenuSnapshot::findItem(const string& itemName) const {
+    for (auto& entry : categoryMenus) {
+        MenuItem* item = entry.second.findItem(itemName);
+        if (item) return item;
+    }
+    return nullptr;
+}
+double MenuSnapshot::getAveragePrice() const {
     double total = 0;
     int count = 0;
     for (auto& entry : categoryMenus) {
-        Menu& m = entry.second;
+        const Menu& m = entry.second;
         MenuItem* temp = m.getItem(1);
         MenuItem* iter = temp;
         while (iter) {
@@ -126,6 +226,63 @@ double Restaurant::getAveragePrice() {
     return count ? (total / count) : 0;
 }
 
+class SnapshotReclaimer {
+private:
+    mutex retiredMutex;
+    vector<pair<unsigned long, MenuSnapshot*>> retired;
+public:
+    void retire(MenuSnapshot* old);
+};
+void SnapshotReclaimer::retire(MenuSnapshot* old) {
+    unsigned long retiredAt = globalEpoch.fetch_add(1);
+    lock_guard<mutex> lock(retiredMutex);
+    retired.push_back({retiredAt, old});
+    unsigned long oldestReader = ~0UL;
+    for (int i = 0; i < MAX_EPOCH_THREADS; i++) {
+        unsigned long e = threadEpochs[i].load();
+        if (e && e < oldestReader) oldestReader = e;
+    }
+    size_t kept = 0;
+    for (auto& entry : retired) {
+        if (entry.first < oldestReader) delete entry.second;
+        else retired[kept++] = entry;
+    }
+    retired.resize(kept);
+}
+SnapshotReclaimer snapshotReclaimer;
+
+class Restaurant {
+private:
+    atomic<MenuSnapshot*> menus;
+    mutex writeMutex; // serializes menu writers only
+public:
+    string name;
+    double rating;
+    Restaurant(string n, double r) : menus(new MenuSnapshot{catalogVersion++, {}}), name(n), rating(r) {}
+    // Caller must hold an EpochGuard for as long as it uses the snapshot
+    const MenuSnapshot* snapshot() const { return menus.load(); }
+    void addMenuItemToCategory(string category, string itemName, double price);
+    double getAveragePrice();
+};
+
+// Adds the item, or reprices it if the category already has it, and publishes a new version
+void Restaurant::addMenuItemToCategory(string category, string itemName, double price) {
+    lock_guard<mutex> lock(writeMutex);
+    MenuSnapshot* current = menus.load();
+    MenuSnapshot* next = new MenuSnapshot(*current);
+    next->version = catalogVersion++;
+    Menu& menu = next->categoryMenus[category];
+    MenuItem* existing = menu.findItem(itemName);
+    if (existing) existing->price = price;
+    else menu.addItem(itemName, price);
+    menus.store(next);
+    snapshotReclaimer.retire(current);
+}
+double Restaurant::getAveragePrice() {
+    EpochGuard guard;
+    return snapshot()->getAveragePrice();
+}
+
 // ======= Global Data Structures =======
 Restaurant r1("Mount Bilal", 4.5);
 Restaurant r2("Jaya Mess", 4.0);
@@ -134,17 +291,43 @@ Restaurant* restaurants[3] = {&r1, &r2, &r3};
 
 queue<Order> previousOrders;
 stack<Order> cancelledOrders;
+// Guards the order queue/stack, offer window and VIP heap when the socket server is running
+mutex engineMutex;
+// Orders are written to disk unless a simulation turns this off
+bool persistOrders = true;
 
 // ======= File Management Functions =======
-// Serialize order to file (append)
-void saveOrderToFile(const Order& order, const string& filename) {
-    ofstream fout(filename, ios::app);
-    fout << order.id << "|" << order.restaurantName << "|";
-    for (const auto& item : order.items) {
-        fout << item.itemName << ":" << item.quantity << ",";
-    }
-    fout << endl;
-    fout.close();
+// One order per line: id|restaurant|item:qty,item:qty,
+string serializeOrder(const Order& o) {
+    ostringstream out;
+    out << o.id << "|" << o.restaurantName << "|";
+    for (auto& i : o.items) out << i.itemName << ":" << i.quantity << ",";
+    return out.str();
+}
+
+// Parses a serialized order; false for blank or torn lines
+bool parseOrderLine(const string& line, Order& order) {
+    if (line.empty()) return false;
+    istringstream ss(line);
+    string idStr, restName, itemsStr;
+    getline(ss, idStr, '|');
+    getline(ss, restName, '|');
+    getline(ss, itemsStr);
+    char* end;
+    long id = strtol(idStr.c_str(), &end, 10);
+    if (idStr.empty() || *end || restName.empty()) return false;
+    vector<OrderItem> items;
+    istringstream itemsStream(itemsStr);
+    string itemPair;
+    while (getline(itemsStream, itemPair, ',')) {
+        size_t colonPos = itemPair.find(':');
+        if (colonPos == string::npos) continue;
+        string name = itemPair.substr(0, colonPos);
+        int quantity = atoi(itemPair.c_str() + colonPos + 1);
+        items.push_back({name, quantity});
+    }
+    order = Order{(int)id, restName, items};
+    return true;
 }
 
 // Load all orders from file into a queue
@@ -152,68 +335,22 @@ void loadOrdersFromFile(const string& filename, queue<Order>& orderQueue) {
     orderQueue = queue<Order>(); // Clear before loading
     ifstream fin(filename);
     string line;
+    Order order;
     while (getline(fin, line)) {
-        if (line.empty()) continue;
-        istringstream ss(line);
-        string idStr, restName, itemsStr;
-        getline(ss, idStr, '|');
-        getline(ss, restName, '|');
-        getline(ss, itemsStr);
-        vector<OrderItem> items;
-        istringstream itemsStream(itemsStr);
-        string itemPair;
-        while (getline(itemsStream, itemPair, ',')) {
-            size_t colonPos = itemPair.find(':');
-            if (colonPos == string::npos) continue;
-            string name = itemPair.substr(0, colonPos);
-            int quantity = stoi(itemPair.substr(colonPos + 1));
-            items.push_back({name, quantity});
-        }
-        orderQueue.push({stoi(idStr), restName, items});
+        if (parseOrderLine(line, order)) orderQueue.push(order);
     }
     fin.close();
 }
 
-// Save stack to file (overwrites, saves all cancelled orders)
-void saveCancelledOrdersToFile(const stack<Order>& orderStack, const string& filename) {
-    ofstream fout(filename);
-    stack<Order> tempStack = orderStack;
-    while (!tempStack.empty()) {
-        const Order& order = tempStack.top();
-        fout << order.id << "|" << order.restaurantName << "|";
-        for (const auto& item : order.items) {
-            fout << item.itemName << ":" << item.quantity << ",";
-        }
-        fout << endl;
-        tempStack.pop();
-    }
-    fout.close();
-}
-
 // Load cancelled orders from file into a stack
 void loadCancelledOrdersFromFile(const string& filename, stack<Order>& orderStack) {
     orderStack = stack<Order>(); // Clear before loading
     ifstream fin(filename);
     string line;
     vector<Order> orders; // Read in reverse for stack
+    Order order;
     while (getline(fin, line)) {
-        if (line.empty()) continue;
-        istringstream ss(line);
-        string idStr, restName, itemsStr;
-        getline(ss, idStr, '|');
-        getline(ss, restName, '|');
-        getline(ss, itemsStr);
-        vector<OrderItem> items;
-        istringstream itemsStream(itemsStr);
-        string itemPair;
-        while (getline(itemsStream, itemPair, ',')) {
-            size_t colonPos = itemPair.find(':');
-            if (colonPos == string::npos) continue;
-            string name = itemPair.substr(0, colonPos);
-            int quantity = stoi(itemPair.substr(colonPos + 1));
-            items.push_back({name, quantity});
-        }
-        orders.push_back({stoi(idStr), restName, items});
+        if (parseOrderLine(line, order)) orders.push_back(order);
     }
     fin.close();
     for (auto it = orders.rbegin(); it != orders.rend(); ++it) {
@@ -221,20 +358,503 @@ void loadCancelledOrdersFromFile(const string& filename, stack<Order>& orderStac
     }
 }
 
-// Helper to rewrite the orders file after cancellation
-void rewriteOrdersFile(const queue<Order>& orderQueue, const string& filename) {
-    ofstream fout(filename);
-    queue<Order> tmp = orderQueue;
-    while (!tmp.empty()) {
-        const Order& o = tmp.front();
-        fout << o.id << "|" << o.restaurantName << "|";
-        for (auto& i : o.items) fout << i.itemName << ":" << i.quantity << ",";
-        fout << endl;
-        tmp.pop();
+// ======= Sharded Order History =======
+// Orders are striped across ORDER_SHARDS shards by id (id % ORDER_SHARDS).
+// Shard k owns two append-only logs:
+//   orders_shard<k>.txt            placed orders, plus "~id" when an order is cancelled
+//   cancelled_orders_shard<k>.txt  seq|id|restaurant|items, seq = global cancellation order
+// and an in-memory index of live order id -> byte offset in its orders log.
+// Placing or cancelling touches one shard; compaction rewrites one shard.
+// The engine reserves a per-shard append ticket under engineMutex and appends
+// after releasing it; tickets keep each shard's log in engine order without
+// the engine ever waiting on a shard (e.g. one that is compacting).
+const int ORDER_SHARDS = 8;
+const long COMPACT_MIN_TOMBSTONES = 64;
+const string ORDER_IMPORT_MARKER = "orders_import.commit";
+
+class OrderShard {
+private:
+    int shardId;
+    string ordersFile, cancelledFile;
+    ofstream ordersOut, cancelledOut;
+    unordered_map<int, streamoff> liveIndex;
+    streamoff ordersSize = 0;
+    long tombstones = 0;
+    mutex shardMutex;
+    atomic<long> ticketsIssued{0};
+    long ticketsApplied = 0;
+    condition_variable ticketTurn;
+    void waitTurn(unique_lock<mutex>& lock, long ticket);
+    void finishTurn();
+    void openLogs();
+    void writeCancelledLocked(long seq, const Order& order);
+    bool overThreshold() const {
+        return tombstones >= COMPACT_MIN_TOMBSTONES && tombstones * 2 > (long)liveIndex.size();
+    }
+    void compactLocked();
+public:
+    OrderShard() : shardId(0) {}
+    void init(int id);
+    bool exists() const;
+    void writeImport(const vector<Order>& orders, const vector<pair<long, Order>>& cancelled);
+    void finishImport();
+    void load(vector<Order>& live, vector<pair<long, Order>>& cancelled);
+    long reserveAppend() { return ticketsIssued++; }
+    void appendOrder(long ticket, const Order& order);
+    void appendCancellation(long ticket, long seq, const Order& order);
+    bool readOrder(int id, Order& out);
+    bool needsCompaction();
+    void compact();
+};
+
+void OrderShard::init(int id) {
+    shardId = id;
+    ordersFile = "orders_shard" + to_string(id) + ".txt";
+    cancelledFile = "cancelled_orders_shard" + to_string(id) + ".txt";
+}
+bool OrderShard::exists() const {
+    return ifstream(ordersFile).good();
+}
+// Writes a legacy import to side files; finishImport() moves them into place
+void OrderShard::writeImport(const vector<Order>& orders, const vector<pair<long, Order>>& cancelled) {
+    ofstream ordersTmp(ordersFile + ".import", ios::trunc | ios::binary);
+    for (const Order& o : orders) ordersTmp << serializeOrder(o) << "\n";
+    ofstream cancelledTmp(cancelledFile + ".import", ios::trunc | ios::binary);
+    for (auto& c : cancelled) cancelledTmp << c.first << "|" << serializeOrder(c.second) << "\n";
+}
+void OrderShard::finishImport() {
+    if (!ifstream(ordersFile + ".import").good()) return; // already moved
+#ifdef _WIN32
+    remove(cancelledFile.c_str());
+    remove(ordersFile.c_str());
+#endif
+    rename((cancelledFile + ".import").c_str(), cancelledFile.c_str());
+    rename((ordersFile + ".import").c_str(), ordersFile.c_str()); // last: marks this shard done
+}
+void OrderShard::openLogs() {
+    if (ordersOut.is_open()) ordersOut.close();
+    if (cancelledOut.is_open()) cancelledOut.close();
+    ordersOut.open(ordersFile, ios::app | ios::binary);
+    cancelledOut.open(cancelledFile, ios::app | ios::binary);
+}
+
+// Reads both logs; tombstones are applied last so a record is dropped wherever its tombstone sits
+void OrderShard::load(vector<Order>& live, vector<pair<long, Order>>& cancelled) {
+    lock_guard<mutex> lock(shardMutex);
+    liveIndex.clear();
+    tombstones = 0;
+    vector<pair<streamoff, Order>> placed;
+    vector<int> cancelledIds;
+    ifstream fin(ordersFile, ios::binary);
+    string line;
+    streamoff offset = 0;
+    Order order;
+    bool tornTail = false;
+    while (getline(fin, line)) {
+        streamoff lineStart = offset;
+        tornTail = fin.eof(); // last line was cut off before its newline
+        if (tornTail) break;
+        offset += line.size() + 1;
+        if (!line.empty() && line[0] == '~') {
+            cancelledIds.push_back(atoi(line.c_str() + 1));
+            tombstones++;
+        } else if (parseOrderLine(line, order)) {
+            placed.push_back({lineStart, order});
+        }
+    }
+    fin.close();
+    if (tornTail) filesystem::resize_file(ordersFile, offset); // drop the partial write
+    ordersSize = offset;
+    sort(cancelledIds.begin(), cancelledIds.end());
+    for (auto& p : placed) {
+        if (binary_search(cancelledIds.begin(), cancelledIds.end(), p.second.id)) {
+            tombstones++;
+            continue;
+        }
+        liveIndex[p.second.id] = p.first;
+        live.push_back(p.second);
+    }
+    sort(live.begin(), live.end(), [](const Order& a, const Order& b) { return a.id < b.id; });
+
+    ifstream cancelledIn(cancelledFile, ios::binary);
+    offset = 0;
+    tornTail = false;
+    while (getline(cancelledIn, line)) {
+        tornTail = cancelledIn.eof();
+        if (tornTail) break;
+        offset += line.size() + 1;
+        size_t bar = line.find('|');
+        if (bar == string::npos) continue;
+        if (parseOrderLine(line.substr(bar + 1), order))
+            cancelled.push_back({atol(line.c_str()), order});
+    }
+    cancelledIn.close();
+    if (tornTail) filesystem::resize_file(cancelledFile, offset);
+    openLogs();
+}
+
+// Appends run strictly in ticket order; caller holds shardMutex
+void OrderShard::waitTurn(unique_lock<mutex>& lock, long ticket) {
+    ticketTurn.wait(lock, [&] { return ticketsApplied == ticket; });
+}
+void OrderShard::finishTurn() {
+    ticketsApplied++;
+    ticketTurn.notify_all();
+}
+
+void OrderShard::appendOrder(long ticket, const Order& order) {
+    unique_lock<mutex> lock(shardMutex);
+    waitTurn(lock, ticket);
+    if (!ordersOut.is_open()) openLogs();
+    string line = serializeOrder(order) + "\n";
+    ordersOut << line << flush;
+    liveIndex[order.id] = ordersSize;
+    ordersSize += line.size();
+    finishTurn();
+}
+
+void OrderShard::appendCancellation(long ticket, long seq, const Order& order) {
+    unique_lock<mutex> lock(shardMutex);
+    waitTurn(lock, ticket);
+    if (!ordersOut.is_open()) openLogs();
+    string tombstone = "~" + to_string(order.id) + "\n";
+    ordersOut << tombstone << flush;
+    ordersSize += tombstone.size();
+    writeCancelledLocked(seq, order);
+    liveIndex.erase(order.id);
+    tombstones += 2; // the dead record and the tombstone itself
+    finishTurn();
+    // Only this shard's appenders wait on the rewrite; the engine never does
+    if (overThreshold()) compactLocked();
+}
+
+void OrderShard::writeCancelledLocked(long seq, const Order& order) {
+    cancelledOut << seq << "|" << serializeOrder(order) << "\n" << flush;
+}
+
+// Point lookup through the shard index without touching other shards
+bool OrderShard::readOrder(int id, Order& out) {
+    lock_guard<mutex> lock(shardMutex);
+    auto it = liveIndex.find(id);
+    if (it == liveIndex.end()) return false;
+    ifstream fin(ordersFile, ios::binary);
+    fin.seekg(it->second);
+    string line;
+    return getline(fin, line) && parseOrderLine(line, out);
+}
+
+bool OrderShard::needsCompaction() {
+    lock_guard<mutex> lock(shardMutex);
+    return overThreshold();
+}
+
+void OrderShard::compact() {
+    lock_guard<mutex> lock(shardMutex);
+    compactLocked();
+}
+
+// Rewrites the orders log with only live records, in id order, and rebuilds the index
+void OrderShard::compactLocked() {
+    ordersOut.close();
+    vector<pair<int, streamoff>> entries(liveIndex.begin(), liveIndex.end());
+    sort(entries.begin(), entries.end());
+    string tmpFile = ordersFile + ".tmp";
+    ifstream fin(ordersFile, ios::binary);
+    ofstream fout(tmpFile, ios::trunc | ios::binary);
+    streamoff offset = 0;
+    string line;
+    for (auto& e : entries) {
+        fin.clear();
+        fin.seekg(e.second);
+        if (!getline(fin, line)) continue;
+        liveIndex[e.first] = offset;
+        fout << line << "\n";
+        offset += line.size() + 1;
     }
+    fin.close();
     fout.close();
+#ifdef _WIN32
+    remove(ordersFile.c_str());
+#endif
+    rename(tmpFile.c_str(), ordersFile.c_str());
+    ordersSize = offset;
+    tombstones = 0;
+    openLogs();
+}
+
+class OrderHistory {
+private:
+    OrderShard shards[ORDER_SHARDS];
+    long nextCancelSeq = 1;
+public:
+    OrderHistory() {
+        for (int i = 0; i < ORDER_SHARDS; i++) shards[i].init(i);
+    }
+    OrderShard& shardFor(int orderId) { return shards[orderId % ORDER_SHARDS]; }
+    void load(queue<Order>& orderQueue, stack<Order>& orderStack);
+    void migrateLegacy(const string& ordersFile, const string& cancelledFile);
+    long nextCancellationSeq() { return nextCancelSeq++; } // caller holds engineMutex
+    bool readOrder(int id, Order& out) { return shardFor(id).readOrder(id, out); }
+    void compactAll();
+};
+
+// Loads every shard on its own thread, then merges live orders by id and
+// cancelled orders by cancellation sequence.
+void OrderHistory::load(queue<Order>& orderQueue, stack<Order>& orderStack) {
+    vector<vector<Order>> live(ORDER_SHARDS);
+    vector<vector<pair<long, Order>>> cancelled(ORDER_SHARDS);
+    vector<thread> loaders;
+    for (int i = 0; i < ORDER_SHARDS; i++)
+        loaders.emplace_back([this, i, &live, &cancelled] { shards[i].load(live[i], cancelled[i]); });
+    for (auto& t : loaders) t.join();
+
+    orderQueue = queue<Order>();
+    typedef pair<int, int> Head; // (order id, shard)
+    priority_queue<Head, vector<Head>, greater<Head>> heads;
+    vector<size_t> pos(ORDER_SHARDS, 0);
+    for (int i = 0; i < ORDER_SHARDS; i++)
+        if (!live[i].empty()) heads.push({live[i][0].id, i});
+    while (!heads.empty()) {
+        int s = heads.top().second;
+        heads.pop();
+        orderQueue.push(live[s][pos[s]++]);
+        if (pos[s] < live[s].size()) heads.push({live[s][pos[s]].id, s});
+    }
+
+    vector<pair<long, Order>> allCancelled;
+    for (auto& c : cancelled) allCancelled.insert(allCancelled.end(), c.begin(), c.end());
+    sort(allCancelled.begin(), allCancelled.end(),
+         [](const pair<long, Order>& a, const pair<long, Order>& b) { return a.first < b.first; });
+    orderStack = stack<Order>();
+    for (auto& c : allCancelled) orderStack.push(c.second);
+    nextCancelSeq = allCancelled.empty() ? 1 : allCancelled.back().first + 1;
+}
+
+// One-time import of the single-file orders.txt / cancelled_orders.txt layout.
+// Shards are written to side files first and moved into place only after the
+// commit marker exists, so a crash either reruns the whole import or finishes
+// moving a complete one on the next start.
+void OrderHistory::migrateLegacy(const string& ordersFile, const string& cancelledFile) {
+    if (ifstream(ORDER_IMPORT_MARKER).good()) {
+        for (int i = 0; i < ORDER_SHARDS; i++) shards[i].finishImport();
+        remove(ORDER_IMPORT_MARKER.c_str());
+        return;
+    }
+    for (int i = 0; i < ORDER_SHARDS; i++)
+        if (shards[i].exists()) return;
+    queue<Order> legacyOrders;
+    stack<Order> legacyCancelled;
+    loadOrdersFromFile(ordersFile, legacyOrders);
+    loadCancelledOrdersFromFile(cancelledFile, legacyCancelled);
+    vector<vector<Order>> orders(ORDER_SHARDS);
+    vector<vector<pair<long, Order>>> cancelled(ORDER_SHARDS);
+    for (; !legacyOrders.empty(); legacyOrders.pop())
+        orders[legacyOrders.front().id % ORDER_SHARDS].push_back(legacyOrders.front());
+    long seq = legacyCancelled.size();
+    for (; !legacyCancelled.empty(); legacyCancelled.pop())
+        cancelled[legacyCancelled.top().id % ORDER_SHARDS].push_back({seq--, legacyCancelled.top()});
+    for (int i = 0; i < ORDER_SHARDS; i++) {
+        reverse(cancelled[i].begin(), cancelled[i].end()); // oldest first, as appended
+        shards[i].writeImport(orders[i], cancelled[i]);
+    }
+    ofstream(ORDER_IMPORT_MARKER).close();
+    for (int i = 0; i < ORDER_SHARDS; i++) shards[i].finishImport();
+    remove(ORDER_IMPORT_MARKER.c_str());
+}
+
+void OrderHistory::compactAll() {
+    vector<thread> workers;
+    for (int i = 0; i < ORDER_SHARDS; i++)
+        workers.emplace_back([this, i] { if (shards[i].needsCompaction()) shards[i].compact(); });
+    for (auto& t : workers) t.join();
+}
+
+OrderHistory orderHistory;
+
+// ======= "Frequently Ordered Together" Index =======
+// Sparse item -> item co-occurrence counts (number of live orders containing
+// both). Each item keeps a small min-heap of its top companions, maintained
+// like the VIP heap, so a lookup just reads the heap. Placing an order adds 1
+// per item pair and cancelling it subtracts 1; rows are striped by item so
+// updates from different orders rarely contend. Updates run outside the engine
+// lock, so a cancellation can land first: the count then dips below zero as a
+// pending removal and is only erased at exactly zero, so the two commute.
+// Lookups return at most TOP_COMPANIONS companions.
+const int TOP_COMPANIONS = 10;
+const int COOCCURRENCE_STRIPES = 16;
+
+struct Companion { string name; int count; };
+
+struct ItemCooccurrence {
+    unordered_map<string, int> counts;
+    Companion top[TOP_COMPANIONS]; // min-heap on count
+    int topSize = 0;
+    bool stale = false; // a heap member's count dropped; rebuild before the next lookup
+    void siftUp(int idx);
+    void siftDown(int idx);
+    void offer(const string& name, int count);
+    void rebuildTop();
+};
+
+void ItemCooccurrence::siftUp(int idx) {
+    while (idx > 0 && top[idx].count < top[(idx-1)/2].count) {
+        swap(top[idx], top[(idx-1)/2]);
+        idx = (idx-1)/2;
+    }
+}
+void ItemCooccurrence::siftDown(int idx) {
+    while (true) {
+        int left = 2*idx + 1, right = 2*idx + 2, smallest = idx;
+        if (left < topSize && top[left].count < top[smallest].count) smallest = left;
+        if (right < topSize && top[right].count < top[smallest].count) smallest = right;
+        if (smallest == idx) break;
+        swap(top[idx], top[smallest]);
+        idx = smallest;
+    }
+}
+// Called with a companion's new count; O(TOP_COMPANIONS)
+void ItemCooccurrence::offer(const string& name, int count) {
+    for (int i = 0; i < topSize; i++) {
+        if (top[i].name != name) continue;
+        bool dropped = count < top[i].count;
+        top[i].count = count;
+        if (dropped) {
+            stale = true; // an outsider may now rank higher
+            siftUp(i);
+        } else {
+            siftDown(i);
+        }
+        return;
+    }
+    if (count <= 0) return;
+    if (topSize < TOP_COMPANIONS) {
+        top[topSize++] = Companion{name, count};
+        siftUp(topSize - 1);
+    } else if (count > top[0].count) {
+        top[0] = Companion{name, count};
+        siftDown(0);
+    }
+}
+void ItemCooccurrence::rebuildTop() {
+    topSize = 0;
+    stale = false;
+    for (auto& c : counts) offer(c.first, c.second);
+}
+
+class CooccurrenceIndex {
+private:
+    struct Stripe {
+        mutex lock;
+        unordered_map<string, ItemCooccurrence> items;
+    };
+    Stripe stripes[COOCCURRENCE_STRIPES];
+    static int stripeOf(const string& item) { return hash<string>()(item) % COOCCURRENCE_STRIPES; }
+    static vector<string> distinctItems(const Order& order);
+    void apply(const Order& order, int delta);
+public:
+    void addOrder(const Order& order) { apply(order, 1); }
+    void removeOrder(const Order& order) { apply(order, -1); }
+    vector<Companion> topCompanions(const string& item, int n);
+    void bulkBuild(const vector<Order>& orders);
+    void clear();
+};
+
+vector<string> CooccurrenceIndex::distinctItems(const Order& order) {
+    vector<string> names;
+    for (auto& i : order.items) names.push_back(i.itemName);
+    sort(names.begin(), names.end());
+    names.erase(unique(names.begin(), names.end()), names.end());
+    return names;
+}
+
+// Touches k*(k-1) cells for an order with k distinct items
+void CooccurrenceIndex::apply(const Order& order, int delta) {
+    vector<string> names = distinctItems(order);
+    for (const string& a : names) {
+        Stripe& s = stripes[stripeOf(a)];
+        lock_guard<mutex> lock(s.lock);
+        ItemCooccurrence& row = s.items[a];
+        for (const string& b : names) {
+            if (a == b) continue;
+            int& count = row.counts[b];
+            count += delta;
+            row.offer(b, count);
+            if (count == 0) row.counts.erase(b);
+        }
+    }
+}
+
+// Most frequent companions first; reads the precomputed heap
+vector<Companion> CooccurrenceIndex::topCompanions(const string& item, int n) {
+    vector<Companion> result;
+    Stripe& s = stripes[stripeOf(item)];
+    {
+        lock_guard<mutex> lock(s.lock);
+        auto it = s.items.find(item);
+        if (it == s.items.end()) return result;
+        ItemCooccurrence& row = it->second;
+        if (row.stale) row.rebuildTop();
+        result.assign(row.top, row.top + row.topSize);
+    }
+    sort(result.begin(), result.end(), [](const Companion& a, const Companion& b) {
+        return a.count != b.count ? a.count > b.count : a.name < b.name;
+    });
+    if ((int)result.size() > n) result.resize(n);
+    return result;
+}
+
+void CooccurrenceIndex::clear() {
+    for (auto& s : stripes) {
+        lock_guard<mutex> lock(s.lock);
+        s.items.clear();
+    }
+}
+
+// Bootstraps the matrix from history: threads count pairs over slices of the
+// orders into per-stripe buckets, then each thread merges and heapifies its
+// own set of stripes, reading only those stripes' buckets.
+void CooccurrenceIndex::bulkBuild(const vector<Order>& orders) {
+    typedef unordered_map<string, unordered_map<string, int>> PairCounts;
+    int threads = max(1, (int)thread::hardware_concurrency());
+    vector<vector<PairCounts>> partial(threads, vector<PairCounts>(COOCCURRENCE_STRIPES));
+    vector<thread> workers;
+    size_t chunk = (orders.size() + threads - 1) / threads;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([&, t] {
+            size_t end = min(orders.size(), (t + 1) * chunk);
+            for (size_t i = t * chunk; i < end; i++) {
+                vector<string> names = distinctItems(orders[i]);
+                for (const string& a : names) {
+                    unordered_map<string, int>& row = partial[t][stripeOf(a)][a];
+                    for (const string& b : names)
+                        if (a != b) row[b]++;
+                }
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+    workers.clear();
+
+    int mergers = min(threads, COOCCURRENCE_STRIPES);
+    for (int t = 0; t < mergers; t++) {
+        workers.emplace_back([&, t] {
+            for (int si = t; si < COOCCURRENCE_STRIPES; si += mergers) {
+                Stripe& s = stripes[si];
+                lock_guard<mutex> lock(s.lock);
+                for (auto& buckets : partial)
+                    for (auto& row : buckets[si]) {
+                        ItemCooccurrence& target = s.items[row.first];
+                        for (auto& c : row.second) target.counts[c.first] += c.second;
+                    }
+                for (auto& item : s.items) item.second.rebuildTop();
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
 }
 
+CooccurrenceIndex cooccurrence;
+
 // ======= System Feature Implementations for Menu Options =======
 void viewAllRestaurants() {
     cout << "\nRestaurants:\n";
@@ -298,28 +918,39 @@ void displayPreviousOrders() {
         }
     }
 }
+// Moves the most recent order onto the cancelled stack; false if there is nothing to cancel
+bool popLatestOrder(Order& latestOrder) {
+    long cancelSeq, ticket = 0;
+    {
+        lock_guard<mutex> lock(engineMutex);
+        if (previousOrders.empty()) return false;
+        queue<Order> tempQueue;
+        while (previousOrders.size() > 1) {
+            tempQueue.push(previousOrders.front());
+            previousOrders.pop();
+        }
+        latestOrder = previousOrders.front();
+        previousOrders.pop();
+        cancelledOrders.push(latestOrder);
+        while (!tempQueue.empty()) {
+            previousOrders.push(tempQueue.front());
+            tempQueue.pop();
+        }
+        cancelSeq = orderHistory.nextCancellationSeq();
+        if (persistOrders) ticket = orderHistory.shardFor(latestOrder.id).reserveAppend();
+    }
+    // File management updates: only the order's own shard is touched
+    if (persistOrders) orderHistory.shardFor(latestOrder.id).appendCancellation(ticket, cancelSeq, latestOrder);
+    cooccurrence.removeOrder(latestOrder);
+    return true;
+}
 void cancelLatestOrder() {
-    if (previousOrders.empty()) {
+    Order latestOrder;
+    if (!popLatestOrder(latestOrder)) {
         cout << "No orders to cancel.\n";
         return;
     }
-    queue<Order> tempQueue;
-    Order latestOrder;
-    while (previousOrders.size() > 1) {
-        tempQueue.push(previousOrders.front());
-        previousOrders.pop();
-    }
-    latestOrder = previousOrders.front();
-    previousOrders.pop();
-    cancelledOrders.push(latestOrder);
-    while (!tempQueue.empty()) {
-        previousOrders.push(tempQueue.front());
-        tempQueue.pop();
-    }
     cout << "Order #" << latestOrder.id << " cancelled.\n";
-    // File management updates
-    saveCancelledOrdersToFile(cancelledOrders, "cancelled_orders.txt");
-    rewriteOrdersFile(previousOrders, "orders.txt");
 }
 void viewCancelledOrders() {
     if (cancelledOrders.empty()) {
@@ -447,16 +1078,13 @@ public:
     string name;
     vector<string> allergies;
     vector<string> conditions;
-    void inputProfile();
+    void inputAllergies();
     static void parseList(string input, vector<string>& list);
     bool isUnsafe(const string& ingredient) const;
     void viewProfile() const;
 };
 
-void HealthProfile::inputProfile() {
-    cout << "\nEnter your name: ";
-    cin >> ws;
-    getline(cin, name);
+void HealthProfile::inputAllergies() {
     cout << "Enter your allergies (comma-separated, e.g., milk,ghee,sugar,egg,coconut). If none, press enter: ";
     string allergyInput;
     getline(cin, allergyInput);
@@ -504,6 +1132,251 @@ void HealthProfile::viewProfile() const {
 }
 HealthProfile userProfile;
 
+// ======= Multi-User Health Profile Store =======
+// Profiles are kept per customer name and appended to profiles.txt
+// (name|allergy,allergy,...|condition,...; the last line for a name wins).
+// Loading replays stripes in parallel and rewrites the log with one line per
+// customer once most of its lines have been superseded.
+// Each profile lazily caches, per restaurant, which menu items are free of its
+// allergens. A cached view is rebuilt only when that restaurant's menu snapshot
+// version or the profile's allergyVersion no longer matches.
+const int PROFILE_STRIPES = 16;
+
+struct SafeMenuView {
+    long menuVersion = -1;
+    long allergyVersion = -1;
+    map<string, vector<int>> safeItems; // category -> safe item numbers (1-based, as in getItem)
+};
+
+struct StoredProfile {
+    HealthProfile profile;
+    long allergyVersion = 0;
+    vector<SafeMenuView> views; // indexed like restaurants[], built on first use
+};
+
+class ProfileStore {
+private:
+    struct Stripe {
+        mutex lock;
+        unordered_map<string, StoredProfile> profiles;
+    };
+    Stripe stripes[PROFILE_STRIPES];
+    atomic<long> nextAllergyVersion{1};
+    mutex fileMutex; // taken after a stripe lock, never before one
+    ofstream logOut;
+    string filename;
+    static int stripeOf(const string& name) { return hash<string>()(name) % PROFILE_STRIPES; }
+    Stripe& stripeFor(const string& name) { return stripes[stripeOf(name)]; }
+    static string joinList(const vector<string>& list);
+    static string lineFor(const HealthProfile& p);
+    void storeLocked(Stripe& s, const HealthProfile& p);
+    void compactLog();
+    const SafeMenuView& viewFor(StoredProfile& sp, int restIdx, const MenuSnapshot* menu);
+public:
+    ProfileStore(const string& file) : filename(file) {}
+    void load();
+    bool find(const string& name, HealthProfile& out);
+    void save(const HealthProfile& p);
+    bool getSafeItems(const string& name, int restIdx, const MenuSnapshot* menu,
+                      const string& category, vector<int>& out);
+    bool isItemSafe(const string& name, int restIdx, const MenuSnapshot* menu,
+                    const string& category, int itemNum);
+    size_t size();
+};
+
+string ProfileStore::joinList(const vector<string>& list) {
+    string out;
+    for (size_t i = 0; i < list.size(); i++) {
+        if (i) out += ",";
+        out += list[i];
+    }
+    return out;
+}
+
+string ProfileStore::lineFor(const HealthProfile& p) {
+    return p.name + "|" + joinList(p.allergies) + "|" + joinList(p.conditions);
+}
+
+void ProfileStore::storeLocked(Stripe& s, const HealthProfile& p) {
+    StoredProfile& sp = s.profiles[p.name];
+    if (sp.allergyVersion == 0 || sp.profile.allergies != p.allergies)
+        sp.allergyVersion = nextAllergyVersion++;
+    sp.profile = p;
+}
+
+// Reads the log once, bucketing lines by stripe; each stripe then replays its
+// lines in file order on its own thread, so the last line for a name still wins
+void ProfileStore::load() {
+    vector<vector<string>> byStripe(PROFILE_STRIPES);
+    size_t lines = 0;
+    ifstream fin(filename);
+    string line;
+    while (getline(fin, line)) {
+        string name = line.substr(0, line.find('|'));
+        if (name.empty()) continue;
+        byStripe[stripeOf(name)].push_back(move(line));
+        lines++;
+    }
+    fin.close();
+
+    int threads = min(max(1, (int)thread::hardware_concurrency()), PROFILE_STRIPES);
+    vector<thread> workers;
+    for (int t = 0; t < threads; t++) {
+        workers.emplace_back([this, t, threads, &byStripe] {
+            for (int si = t; si < PROFILE_STRIPES; si += threads) {
+                Stripe& s = stripes[si];
+                lock_guard<mutex> lock(s.lock);
+                for (const string& entry : byStripe[si]) {
+                    istringstream ss(entry);
+                    HealthProfile p;
+                    string allergyStr, conditionStr;
+                    getline(ss, p.name, '|');
+                    getline(ss, allergyStr, '|');
+                    getline(ss, conditionStr);
+                    HealthProfile::parseList(allergyStr, p.allergies);
+                    HealthProfile::parseList(conditionStr, p.conditions);
+                    storeLocked(s, p);
+                }
+            }
+        });
+    }
+    for (auto& w : workers) w.join();
+
+    if (lines > 2 * size()) compactLog();
+}
+
+// Rewrites the log with only the current profile of each customer; runs from
+// load(), before any save can append
+void ProfileStore::compactLog() {
+    vector<string> current;
+    for (auto& s : stripes) {
+        lock_guard<mutex> lock(s.lock);
+        for (auto& entry : s.profiles) current.push_back(lineFor(entry.second.profile));
+    }
+    lock_guard<mutex> fileLock(fileMutex);
+    if (logOut.is_open()) logOut.close();
+    string tmpFile = filename + ".tmp";
+    ofstream fout(tmpFile, ios::trunc);
+    for (const string& entry : current) fout << entry << "\n";
+    fout.close();
+#ifdef _WIN32
+    remove(filename.c_str());
+#endif
+    rename(tmpFile.c_str(), filename.c_str());
+}
+
+bool ProfileStore::find(const string& name, HealthProfile& out) {
+    Stripe& s = stripeFor(name);
+    lock_guard<mutex> lock(s.lock);
+    auto it = s.profiles.find(name);
+    if (it == s.profiles.end()) return false;
+    out = it->second.profile;
+    return true;
+}
+
+// Upserts the profile and appends it to the profile log under the same stripe
+// lock, so updates to one customer reach the log in the order they took effect
+void ProfileStore::save(const HealthProfile& p) {
+    Stripe& s = stripeFor(p.name);
+    lock_guard<mutex> lock(s.lock);
+    storeLocked(s, p);
+    lock_guard<mutex> fileLock(fileMutex);
+    if (!logOut.is_open()) logOut.open(filename, ios::app);
+    logOut << lineFor(p) << endl;
+}
+
+// Caller holds the profile's stripe lock and an EpochGuard pinning menu
+const SafeMenuView& ProfileStore::viewFor(StoredProfile& sp, int restIdx, const MenuSnapshot* menu) {
+    if ((int)sp.views.size() < 3) sp.views.resize(3);
+    SafeMenuView& view = sp.views[restIdx];
+    if (view.menuVersion == menu->version && view.allergyVersion == sp.allergyVersion)
+        return view;
+    view.safeItems.clear();
+    view.menuVersion = menu->version;
+    view.allergyVersion = sp.allergyVersion;
+    for (auto& entry : menu->categoryMenus) {
+        vector<int>& safe = view.safeItems[entry.first];
+        int idx = 1;
+        for (MenuItem* item = entry.second.getItem(1); item; item = item->next, idx++) {
+            bool unsafe = false;
+            auto it = foodIngredients.find(item->name);
+            if (it != foodIngredients.end())
+                for (const string& ing : it->second)
+                    if (sp.profile.isUnsafe(ing)) { unsafe = true; break; }
+            if (!unsafe) safe.push_back(idx);
+        }
+    }
+    return view;
+}
+
+bool ProfileStore::getSafeItems(const string& name, int restIdx, const MenuSnapshot* menu,
+                                const string& category, vector<int>& out) {
+    Stripe& s = stripeFor(name);
+    lock_guard<mutex> lock(s.lock);
+    auto it = s.profiles.find(name);
+    if (it == s.profiles.end()) return false;
+    const SafeMenuView& view = viewFor(it->second, restIdx, menu);
+    auto cat = view.safeItems.find(category);
+    out = cat != view.safeItems.end() ? cat->second : vector<int>();
+    return true;
+}
+
+// Unknown customers have no recorded allergies, so everything is safe for them
+bool ProfileStore::isItemSafe(const string& name, int restIdx, const MenuSnapshot* menu,
+                              const string& category, int itemNum) {
+    vector<int> safe;
+    if (!getSafeItems(name, restIdx, menu, category, safe)) return true;
+    return binary_search(safe.begin(), safe.end(), itemNum);
+}
+
+size_t ProfileStore::size() {
+    size_t total = 0;
+    for (auto& s : stripes) {
+        lock_guard<mutex> lock(s.lock);
+        total += s.profiles.size();
+    }
+    return total;
+}
+
+ProfileStore profileStore("profiles.txt");
+
+// Returning customers get their saved profile; new ones are asked for allergies
+void loginProfile() {
+    cout << "\nEnter your name: ";
+    cin >> ws;
+    getline(cin, userProfile.name);
+    if (profileStore.find(userProfile.name, userProfile)) {
+        cout << "Welcome back, " << userProfile.name << "! Your saved health profile was loaded.\n";
+        return;
+    }
+    userProfile.inputAllergies();
+    profileStore.save(userProfile);
+}
+
+// Shows only the items that are safe for the given profile, keeping their menu numbers
+void displaySafeCategoryMenu(int restIdx, const MenuSnapshot* menu, const string& category,
+                             const string& profileName) {
+    vector<int> safe;
+    if (!profileStore.getSafeItems(profileName, restIdx, menu, category, safe)) {
+        menu->displayCategoryMenu(category);
+        return;
+    }
+    cout << category << " Menu:\n";
+    size_t next = 0;
+    int idx = 1, hiddenHere = 0;
+    for (MenuItem* item = menu->getMenu(category)->getItem(1); item; item = item->next, idx++) {
+        if (next < safe.size() && safe[next] == idx) {
+            cout << idx << ". " << item->name << " - Rs." << item->price << endl;
+            next++;
+        } else {
+            hiddenHere++;
+        }
+    }
+    if (hiddenHere)
+        cout << "(" << hiddenHere << " item(s) hidden: they contain your allergens)\n";
+}
+
+
 int orderCounter = 1;
 deque<pair<time_t, int>> windowedOffers;
 const int OFFER_LIMIT = 50;
@@ -511,12 +1384,48 @@ const int PROMO_WINDOW_SECS = 7200;
 const int PROMO_START_HOUR = 21;
 const int PROMO_END_HOUR = 23;
 
+// ======= Clock =======
+// All time-dependent pricing reads the time through activeClock so the
+// simulator can replay peak hours in virtual time.
+class Clock {
+public:
+    virtual ~Clock() {}
+    virtual time_t now() const = 0;
+};
+class SystemClock : public Clock {
+public:
+    time_t now() const override { return time(nullptr); }
+};
+// Virtual time is per thread: each simulator worker sees its own event's time
+class VirtualClock : public Clock {
+private:
+    static thread_local time_t current;
+public:
+    VirtualClock(time_t start) { current = start; }
+    time_t now() const override { return current; }
+    void set(time_t t) { current = t; }
+};
+thread_local time_t VirtualClock::current = 0;
+SystemClock systemClock;
+Clock* activeClock = &systemClock;
+
 // ======= Discount, Offers, VIP Heap Helpers =======
+// Thread-safe localtime; server workers read the hour concurrently
+struct tm localTimeOf(time_t t) {
+    struct tm result;
+#ifdef _WIN32
+    localtime_s(&result, &t);
+#else
+    localtime_r(&t, &result);
+#endif
+    return result;
+}
+int getHourAt(time_t t) {
+    t += 19800; // for IST; adjust as needed for your region
+    return localTimeOf(t).tm_hour;
+}
 int getCurrentHour() {
-    time_t now = time(nullptr);
-    now += 19800; // for IST; adjust as needed for your region
-    struct tm* now_tm = localtime(&now);
-    return now_tm->tm_hour;
+    return getHourAt(activeClock->now());
 }
 bool isClosingDiscountTime() {
     int hour = getCurrentHour();
@@ -527,11 +1436,11 @@ bool isTwentyPercentOfferTime() {
     return (hour >= PROMO_START_HOUR && hour < PROMO_END_HOUR);
 }
 bool isEligibleForOffer(int orderId) {
-    time_t currTime = time(nullptr);
+    time_t currTime = activeClock->now();
     while (!windowedOffers.empty() &&
             difftime(currTime, windowedOffers.front().first) > PROMO_WINDOW_SECS)
         windowedOffers.pop_front();
-    int hour = getCurrentHour();
+    int hour = getHourAt(currTime);
     if (hour < PROMO_START_HOUR || hour >= PROMO_END_HOUR) return false;
     if ((int)windowedOffers.size() < OFFER_LIMIT) {
         windowedOffers.push_back({currTime, orderId});
@@ -603,20 +1512,360 @@ void showVIPs() {
     }
 }
 
-void viewMenuAndPlaceOrder() {
-    cout << "Enter customer name: ";
-    string customerName;
-    cin >> ws; getline(cin, customerName);
+// ======= Order Engine (shared by the console and the socket server) =======
+struct PlacedOrder {
+    Order order;
+    double totalPrice;
+    bool offerWinner;
+    bool vip;
+};
 
-    viewAllRestaurants();
-    cout << "Select a restaurant (1-3): ";
-    int rInd;
-    cin >> rInd;
+double applyTimeDiscount(double price, bool discountActive) {
+    if (discountActive) return price * 0.5;
+    if (isTwentyPercentOfferTime()) return price * 0.8;
+    return price;
+}
+
+// Assigns an id, records and persists the order, then updates offers and VIP standings
+PlacedOrder submitOrder(const string& customerName, Restaurant* rest,
+                        const vector<OrderItem>& itemsOrdered, double totalPrice) {
+    PlacedOrder placed;
+    long ticket = 0;
+    {
+        lock_guard<mutex> lock(engineMutex);
+        placed.order = Order{orderCounter++, rest->name, itemsOrdered};
+        placed.totalPrice = totalPrice;
+        previousOrders.push(placed.order);
+        placed.offerWinner = isEligibleForOffer(placed.order.id);
+        customerOrderCount[customerName]++;
+        rebuildHeap();
+        placed.vip = isVIP(customerName);
+        // A cancellation of this order gets a later ticket, so its tombstone
+        // cannot reach the shard ahead of the record
+        if (persistOrders) ticket = orderHistory.shardFor(placed.order.id).reserveAppend();
+    }
+    // File management integration: appends to different shards run in parallel
+    if (persistOrders) orderHistory.shardFor(placed.order.id).appendOrder(ticket, placed.order);
+    cooccurrence.addOrder(placed.order);
+    return placed;
+}
+
+// ======= Shared Group Carts =======
+// Members add to one cart concurrently. Entries are pushed onto a lock-free
+// list with compare-and-swap; checkout swaps in a closed marker so the cart
+// is frozen atomically, then merges the entries into a single Order. Prices
+// are integer paise captured from the menu version each member saw.
+long long toMinorUnits(double rupees) {
+    return llround(rupees * 100);
+}
+string formatMinorUnits(long long paise) {
+    ostringstream out;
+    out << "Rs." << paise / 100 << "." << (paise % 100 < 10 ? "0" : "") << paise % 100;
+    return out.str();
+}
+// Same discounts as applyTimeDiscount, rounded to the nearest paisa per unit
+long long discountedMinorUnits(long long unitPaise, bool discountActive, bool twentyActive) {
+    if (discountActive) return (unitPaise * 50 + 50) / 100;
+    if (twentyActive) return (unitPaise * 80 + 50) / 100;
+    return unitPaise;
+}
+
+struct CartEntry {
+    string member;
+    string itemName;
+    int quantity;
+    long long unitPaise;
+    CartEntry* next;
+};
+
+// One priced item a member adds to a cart
+struct CartLine {
+    string itemName;
+    int quantity;
+    long long unitPaise;
+};
+
+class GroupCart {
+private:
+    atomic<CartEntry*> head;
+    atomic<time_t> lastActive; // read through activeClock, for expiring carts nobody checks out
+    static CartEntry closedMarker;
+public:
+    const int id;
+    const int restIdx;
+    GroupCart(int cartId, int restaurantIdx)
+        : head(nullptr), lastActive(activeClock->now()), id(cartId), restIdx(restaurantIdx) {}
+    ~GroupCart();
+    bool add(const string& member, const vector<CartLine>& lines);
+    bool close(vector<CartEntry>& entries);
+    time_t idleSince() const { return lastActive.load(); }
+};
+CartEntry GroupCart::closedMarker;
+
+GroupCart::~GroupCart() {
+    CartEntry* entry = head.load();
+    while (entry && entry != &closedMarker) {
+        CartEntry* next = entry->next;
+        delete entry;
+        entry = next;
+    }
+}
+
+// Lock-free push of all lines as one chain, so a member's items land together
+// or not at all; false once the cart has been checked out
+bool GroupCart::add(const string& member, const vector<CartLine>& lines) {
+    if (lines.empty()) return true;
+    CartEntry* last = nullptr;
+    CartEntry* first = nullptr;
+    for (const CartLine& line : lines) {
+        CartEntry* entry = new CartEntry{member, line.itemName, line.quantity, line.unitPaise, first};
+        if (!last) last = entry;
+        first = entry;
+    }
+    CartEntry* current = head.load();
+    do {
+        if (current == &closedMarker) {
+            while (first) {
+                CartEntry* next = first == last ? nullptr : first->next;
+                delete first;
+                first = next;
+            }
+            return false;
+        }
+        last->next = current;
+    } while (!head.compare_exchange_weak(current, first));
+    lastActive.store(activeClock->now());
+    return true;
+}
+
+// Freezes the cart and hands back its entries in the order they were added
+bool GroupCart::close(vector<CartEntry>& entries) {
+    CartEntry* entry = head.exchange(&closedMarker);
+    if (entry == &closedMarker) return false;
+    entries.clear();
+    while (entry) {
+        entries.push_back(*entry);
+        CartEntry* next = entry->next;
+        delete entry;
+        entry = next;
+    }
+    reverse(entries.begin(), entries.end());
+    return true;
+}
+
+// Carts that are never checked out are dropped once idle for CART_IDLE_SECS,
+// and at most MAX_OPEN_CARTS may be open at a time
+const int MAX_OPEN_CARTS = 10000;
+const int CART_IDLE_SECS = 1800;
+
+class GroupCartRegistry {
+private:
+    shared_mutex cartsMutex; // only guards the id -> cart map, never item merging
+    unordered_map<int, shared_ptr<GroupCart>> carts;
+    atomic<int> nextCartId{1};
+    void dropIdleLocked();
+public:
+    int open(int restIdx); // 0 if too many carts are open
+    shared_ptr<GroupCart> find(int cartId);
+    shared_ptr<GroupCart> take(int cartId);
+};
+void GroupCartRegistry::dropIdleLocked() {
+    time_t cutoff = activeClock->now() - CART_IDLE_SECS;
+    for (auto it = carts.begin(); it != carts.end();) {
+        if (it->second->idleSince() < cutoff) it = carts.erase(it);
+        else ++it;
+    }
+}
+int GroupCartRegistry::open(int restIdx) {
+    unique_lock<shared_mutex> lock(cartsMutex);
+    if ((int)carts.size() >= MAX_OPEN_CARTS) dropIdleLocked();
+    if ((int)carts.size() >= MAX_OPEN_CARTS) return 0;
+    int cartId = nextCartId++;
+    carts[cartId] = make_shared<GroupCart>(cartId, restIdx);
+    return cartId;
+}
+shared_ptr<GroupCart> GroupCartRegistry::find(int cartId) {
+    shared_lock<shared_mutex> lock(cartsMutex);
+    auto it = carts.find(cartId);
+    return it != carts.end() ? it->second : nullptr;
+}
+shared_ptr<GroupCart> GroupCartRegistry::take(int cartId) {
+    unique_lock<shared_mutex> lock(cartsMutex);
+    auto it = carts.find(cartId);
+    if (it == carts.end()) return nullptr;
+    shared_ptr<GroupCart> cart = it->second;
+    carts.erase(it);
+    return cart;
+}
+GroupCartRegistry groupCarts;
+
+// Adds a member's priced lines; nothing is added unless every line is valid
+string addToGroupCart(int cartId, const string& member, const vector<CartLine>& lines) {
+    shared_ptr<GroupCart> cart = groupCarts.find(cartId);
+    if (!cart) return "no such group cart";
+    if (member.empty()) return "missing member name";
+    if (lines.empty()) return "no items";
+    for (const CartLine& line : lines)
+        if (line.quantity <= 0) return "invalid quantity for " + line.itemName;
+    if (!cart->add(member, lines)) return "group cart already checked out";
+    return "";
+}
+
+// Prices items for the cart's restaurant, all from the same menu version
+string priceCartLines(int cartId, const vector<OrderItem>& items, vector<CartLine>& lines) {
+    shared_ptr<GroupCart> cart = groupCarts.find(cartId);
+    if (!cart) return "no such group cart";
+    EpochGuard menuGuard;
+    const MenuSnapshot* menu = restaurants[cart->restIdx]->snapshot();
+    lines.clear();
+    for (const OrderItem& i : items) {
+        MenuItem* item = menu->findItem(i.itemName);
+        if (!item) return "unknown item " + i.itemName;
+        lines.push_back({item->name, i.quantity, toMinorUnits(item->price)});
+    }
+    return "";
+}
+
+struct GroupCheckout {
+    PlacedOrder placed;
+    long long totalPaise;
+    vector<pair<string, long long>> memberSubtotals; // in the order members joined
+};
+
+// Closes the cart and submits it as one order; the total is exactly the sum of member subtotals
+string checkoutGroupCart(int cartId, const string& organiser, GroupCheckout& result) {
+    shared_ptr<GroupCart> cart = groupCarts.take(cartId);
+    if (!cart) return "no such group cart";
+    vector<CartEntry> entries;
+    if (!cart->close(entries)) return "group cart already checked out";
+    if (entries.empty()) return "group cart was empty and has been closed";
+
+    bool discountActive = isClosingDiscountTime();
+    bool twentyActive = !discountActive && isTwentyPercentOfferTime();
+    vector<OrderItem> merged;
+    map<string, size_t> mergedIdx;
+    map<string, size_t> memberIdx;
+    result.memberSubtotals.clear();
+    result.totalPaise = 0;
+    for (const CartEntry& e : entries) {
+        auto it = mergedIdx.find(e.itemName);
+        if (it == mergedIdx.end()) {
+            mergedIdx[e.itemName] = merged.size();
+            merged.push_back({e.itemName, e.quantity});
+        } else {
+            merged[it->second].quantity += e.quantity;
+        }
+        auto m = memberIdx.find(e.member);
+        if (m == memberIdx.end()) {
+            m = memberIdx.insert({e.member, result.memberSubtotals.size()}).first;
+            result.memberSubtotals.push_back({e.member, 0});
+        }
+        long long linePaise = discountedMinorUnits(e.unitPaise, discountActive, twentyActive) * e.quantity;
+        result.memberSubtotals[m->second].second += linePaise;
+        result.totalPaise += linePaise;
+    }
+    result.placed = submitOrder(organiser.empty() ? entries[0].member : organiser,
+                                restaurants[cart->restIdx], merged, result.totalPaise / 100.0);
+    return "";
+}
+
+void printGroupCheckout(const GroupCheckout& checkout) {
+    cout << "\n--- Group Order #" << checkout.placed.order.id << " ---\n";
+    for (auto& i : checkout.placed.order.items) cout << i.itemName << " x" << i.quantity << endl;
+    cout << "Total price: " << formatMinorUnits(checkout.totalPaise) << endl;
+    for (auto& m : checkout.memberSubtotals)
+        cout << "  " << m.first << " pays " << formatMinorUnits(m.second) << endl;
+}
+
+// Console version: members take turns adding to the shared cart
+void placeGroupOrder() {
+    viewAllRestaurants();
+    cout << "Select a restaurant (1-3): ";
+    int rInd;
+    cin >> rInd;
+    if (rInd < 1 || rInd > 3) {
+        cout << "Invalid restaurant selection.\n";
+        return;
+    }
+    int cartId = groupCarts.open(rInd - 1);
+    if (!cartId) {
+        cout << "Too many group carts are open; try again later.\n";
+        return;
+    }
+    cout << "Group cart #" << cartId << " opened.\n";
+    while (true) {
+        cout << "\nMember name (type 'done' to check out): ";
+        string member;
+        cin >> ws; getline(cin, member);
+        if (member == "done") break;
+        EpochGuard menuGuard;
+        const MenuSnapshot* menu = restaurants[rInd - 1]->snapshot();
+        cout << "Categories:\n";
+        menu->displayCategories();
+        cout << "Select category name (type exactly as shown): ";
+        string category;
+        cin >> ws; getline(cin, category);
+        if (!menu->getMenu(category)) {
+            cout << "Invalid category.\n";
+            continue;
+        }
+        menu->displayCategoryMenu(category);
+        cout << "Select item number to order: ";
+        int itemNum;
+        cin >> itemNum;
+        MenuItem* item = menu->getMenu(category)->getItem(itemNum);
+        if (!item) {
+            cout << "Invalid item selection.\n";
+            continue;
+        }
+        cout << "Enter quantity: ";
+        int qty; cin >> qty;
+        // Charged at the price shown from this menu version
+        string error = addToGroupCart(cartId, member, {{item->name, qty, toMinorUnits(item->price)}});
+        if (!error.empty()) cout << "Could not add item: " << error << ".\n";
+        else cout << item->name << " x" << qty << " added for " << member << ".\n";
+    }
+    GroupCheckout checkout;
+    string error = checkoutGroupCart(cartId, userProfile.name, checkout);
+    if (!error.empty()) {
+        cout << "Group order not placed: " << error << ".\n";
+        return;
+    }
+    printGroupCheckout(checkout);
+}
+
+// Printed after an item is added; only suggests items this restaurant still sells
+void showCompanionSuggestions(const MenuSnapshot* menu, const string& itemName) {
+    vector<Companion> companions = cooccurrence.topCompanions(itemName, 3);
+    string list;
+    for (auto& c : companions) {
+        if (!menu->findItem(c.name)) continue;
+        if (!list.empty()) list += ", ";
+        list += c.name;
+    }
+    if (!list.empty()) cout << "Frequently ordered together with " << itemName << ": " << list << "\n";
+}
+
+void viewMenuAndPlaceOrder() {
+    cout << "Enter customer name: ";
+    string customerName;
+    cin >> ws; getline(cin, customerName);
+
+    viewAllRestaurants();
+    cout << "Select a restaurant (1-3): ";
+    int rInd;
+    cin >> rInd;
     if (rInd < 1 || rInd > 3) {
         cout << "Invalid restaurant selection.\n";
         return;
     }
     Restaurant* rest = restaurants[rInd - 1];
+    // The whole session prices against the menu version it started with
+    EpochGuard menuGuard;
+    const MenuSnapshot* menu = rest->snapshot();
+    // Allergy checks use the customer's saved profile, or the signed-in user's
+    HealthProfile orderProfile = userProfile;
+    if (!profileStore.find(customerName, orderProfile)) orderProfile = userProfile;
 
     vector<OrderItem> itemsOrdered;
     char more = 'y';
@@ -624,34 +1873,34 @@ void viewMenuAndPlaceOrder() {
     bool discountActive = isClosingDiscountTime();
     while (more == 'y' || more == 'Y') {
         cout << "\nCategories:\n";
-        rest->displayCategories();
+        menu->displayCategories();
         cout << "Select category name (type exactly as shown): ";
         string category;
         cin >> ws; getline(cin, category);
 
-        if (rest->categoryMenus.find(category) == rest->categoryMenus.end()) {
+        if (!menu->getMenu(category)) {
             cout << "Invalid category.\n";
             continue;
         }
 
-        rest->displayCategoryMenu(category);
+        displaySafeCategoryMenu(rInd - 1, menu, category, orderProfile.name);
 
         cout << "Select item number to order: ";
         int itemNum;
         cin >> itemNum;
-        MenuItem* item = rest->categoryMenus[category].getItem(itemNum);
+        MenuItem* item = menu->getMenu(category)->getItem(itemNum);
         if (!item) {
             cout << "Invalid item selection.\n";
             continue;
         }
 
-        auto it = foodIngredients.find(item->name);
         bool riskDetected = false;
-        if (it != foodIngredients.end()) {
+        if (!profileStore.isItemSafe(orderProfile.name, rInd - 1, menu, category, itemNum)) {
+            auto it = foodIngredients.find(item->name);
             for (const string& ing : it->second) {
-                if (userProfile.isUnsafe(ing)) {
+                if (orderProfile.isUnsafe(ing)) {
                     cout << "\n⚠  Warning: " << item->name << " contains '" << ing
-                         << "' which may be unsafe for you (" << userProfile.name << ").\n";
+                         << "' which may be unsafe for you (" << orderProfile.name << ").\n";
                     riskDetected = true;
                 }
             }
@@ -670,13 +1919,8 @@ void viewMenuAndPlaceOrder() {
         cout << "Enter quantity: ";
         int qty; cin >> qty;
         itemsOrdered.push_back({item->name, qty});
-        double priceToUse = item->price;
-        if (discountActive) {
-            priceToUse *= 0.5;
-        } else if (isTwentyPercentOfferTime()) {
-            priceToUse *= 0.8;
-        }
-        totalPrice += priceToUse * qty;
+        totalPrice += applyTimeDiscount(item->price, discountActive) * qty;
+        showCompanionSuggestions(menu, item->name);
         cout << "Add more items? (y/n): ";
         cin >> more;
     }
@@ -684,13 +1928,9 @@ void viewMenuAndPlaceOrder() {
         cout << "\nNo items were ordered. Order was not placed.\n";
         return; // Exit without creating an order
     }
-    int id = orderCounter++;
-    Order newOrder{id, rest->name, itemsOrdered};
-    previousOrders.push(newOrder);
-    // File management integration
-    saveOrderToFile(newOrder, "orders.txt");
+    PlacedOrder placed = submitOrder(customerName, rest, itemsOrdered, totalPrice);
 
-    if (isEligibleForOffer(id)) {
+    if (placed.offerWinner) {
         cout << "\nCongratulations! You are among the first 50 customers from 9 to 11 PM and received a special offer!\n";
     } else {
         cout << "\nOrder placed (standard pricing).\n";
@@ -717,26 +1957,1013 @@ void viewMenuAndPlaceOrder() {
         cout << "\n--- Group Split Summary ---\n";
         cout << "Total Bill: Rs." << totalPrice << endl;
         if (n > 0) {
-            double perPerson = totalPrice / n;
-            cout << "Each member should pay: Rs." << perPerson << endl;
+            // Split in paise; the first (total % n) members cover the leftover paise
+            long long totalPaise = toMinorUnits(totalPrice);
+            long long share = totalPaise / n, extra = totalPaise % n;
+            if (extra)
+                cout << extra << " member(s) pay " << formatMinorUnits(share + 1) << ", "
+                     << n - extra << " member(s) pay " << formatMinorUnits(share) << endl;
+            else
+                cout << "Each member should pay: " << formatMinorUnits(share) << endl;
             cout << "All settled perfectly!\n";
         } else {
             cout << "No members specified.\n";
         }
     }
-    customerOrderCount[customerName]++;
-    rebuildHeap();
-    if (isVIP(customerName)) {
+    if (placed.vip) {
         cout << "[VIP] You are a Top 5 Customer!\n";
         showVIPs();
     }
 }
 
+// ======= Socket Server Protocol =======
+// One request per line, one response line per request, answered in order so a
+// client may pipeline many requests without waiting. Responses start with OK or ERR.
+//   R                               list restaurants
+//   M <r>                           menu of restaurant r (1-3)
+//   P <customer>|<r>|<item>:<qty>,..  place an order
+//   C                               cancel latest order
+//   H                               previous orders
+//   X                               cancelled orders
+//   O <id>                          one live order, read through its shard's index
+//   T <item>|<n>                    top n (at most 10) items frequently ordered together with item
+//   G <r>                           open a shared group cart for restaurant r
+//   J <cart>|<member>|<item>:<qty>,.. add a member's items to a group cart
+//   K <cart>|<organiser>            check out a group cart as one order
+//   S                               restaurants sorted by rating
+//   A                               restaurants sorted by average price
+//   N <customer>|<allergy>,...      create or update a customer's health profile
+//   F <customer>|<r>                menu of restaurant r filtered by the customer's allergies
+//   U <r>|<category>|<item>|<price> add or reprice a menu item (publishes a new menu version)
+Restaurant* parseRestaurantIndex(const string& text) {
+    int rInd = atoi(text.c_str());
+    if (rInd < 1 || rInd > 3) return nullptr;
+    return restaurants[rInd - 1];
+}
+
+string handlePlaceOrderRequest(const string& args) {
+    istringstream ss(args);
+    string customerName, restStr, itemsStr;
+    getline(ss, customerName, '|');
+    getline(ss, restStr, '|');
+    getline(ss, itemsStr);
+    if (customerName.empty()) return "ERR missing customer name";
+    Restaurant* rest = parseRestaurantIndex(restStr);
+    if (!rest) return "ERR invalid restaurant";
+
+    EpochGuard menuGuard;
+    const MenuSnapshot* menu = rest->snapshot();
+    vector<OrderItem> itemsOrdered;
+    double totalPrice = 0.0;
+    bool discountActive = isClosingDiscountTime();
+    istringstream itemsStream(itemsStr);
+    string itemPair;
+    while (getline(itemsStream, itemPair, ',')) {
+        size_t colonPos = itemPair.find(':');
+        if (colonPos == string::npos) continue;
+        string name = itemPair.substr(0, colonPos);
+        int qty = atoi(itemPair.c_str() + colonPos + 1);
+        MenuItem* item = menu->findItem(name);
+        if (!item) return "ERR unknown item " + name;
+        if (qty <= 0) return "ERR invalid quantity for " + name;
+        itemsOrdered.push_back({item->name, qty});
+        totalPrice += applyTimeDiscount(item->price, discountActive) * qty;
+    }
+    if (itemsOrdered.empty()) return "ERR no items";
+
+    PlacedOrder placed = submitOrder(customerName, rest, itemsOrdered, totalPrice);
+    ostringstream out;
+    out << "OK " << placed.order.id << " " << placed.totalPrice;
+    if (placed.offerWinner) out << " OFFER";
+    if (placed.vip) out << " VIP";
+    return out.str();
+}
+
+string handleRequest(const string& line) {
+    if (line.empty()) return "ERR empty request";
+    char cmd = line[0];
+    string args = line.size() > 2 ? line.substr(2) : "";
+    ostringstream out;
+    switch (cmd) {
+        case 'R': {
+            out << "OK ";
+            for (int i = 0; i < 3; i++)
+                out << restaurants[i]->name << ":" << restaurants[i]->rating << ";";
+            return out.str();
+        }
+        case 'M': {
+            Restaurant* rest = parseRestaurantIndex(args);
+            if (!rest) return "ERR invalid restaurant";
+            EpochGuard menuGuard;
+            out << "OK ";
+            for (auto& entry : rest->snapshot()->categoryMenus) {
+                for (MenuItem* item = entry.second.getItem(1); item; item = item->next)
+                    out << entry.first << "/" << item->name << ":" << item->price << ";";
+            }
+            return out.str();
+        }
+        case 'P': return handlePlaceOrderRequest(args);
+        case 'N': {
+            size_t bar = args.find('|');
+            HealthProfile p;
+            p.name = args.substr(0, bar);
+            if (p.name.empty()) return "ERR missing customer name";
+            profileStore.find(p.name, p);
+            HealthProfile::parseList(bar == string::npos ? "" : args.substr(bar + 1), p.allergies);
+            profileStore.save(p);
+            return "OK";
+        }
+        case 'F': {
+            size_t bar = args.find('|');
+            if (bar == string::npos) return "ERR expected <customer>|<r>";
+            string customerName = args.substr(0, bar);
+            Restaurant* rest = parseRestaurantIndex(args.substr(bar + 1));
+            if (!rest) return "ERR invalid restaurant";
+            int restIdx = atoi(args.c_str() + bar + 1) - 1;
+            EpochGuard menuGuard;
+            const MenuSnapshot* menu = rest->snapshot();
+            out << "OK ";
+            for (auto& entry : menu->categoryMenus) {
+                vector<int> safe;
+                if (!profileStore.getSafeItems(customerName, restIdx, menu, entry.first, safe))
+                    return "ERR unknown customer";
+                size_t next = 0;
+                int idx = 1;
+                for (MenuItem* item = entry.second.getItem(1); item && next < safe.size(); item = item->next, idx++) {
+                    if (safe[next] != idx) continue;
+                    out << entry.first << "/" << item->name << ":" << item->price << ";";
+                    next++;
+                }
+            }
+            return out.str();
+        }
+        case 'U': {
+            istringstream ss(args);
+            string restStr, category, itemName, priceStr;
+            getline(ss, restStr, '|');
+            getline(ss, category, '|');
+            getline(ss, itemName, '|');
+            getline(ss, priceStr);
+            Restaurant* rest = parseRestaurantIndex(restStr);
+            if (!rest) return "ERR invalid restaurant";
+            double price = atof(priceStr.c_str());
+            if (category.empty() || itemName.empty() || price <= 0) return "ERR expected <r>|<category>|<item>|<price>";
+            rest->addMenuItemToCategory(category, itemName, price);
+            EpochGuard menuGuard;
+            out << "OK " << rest->snapshot()->version;
+            return out.str();
+        }
+        case 'C': {
+            Order latestOrder;
+            if (!popLatestOrder(latestOrder)) return "ERR no orders to cancel";
+            out << "OK " << latestOrder.id;
+            return out.str();
+        }
+        case 'H': {
+            lock_guard<mutex> lock(engineMutex);
+            out << "OK ";
+            queue<Order> temp = previousOrders;
+            while (!temp.empty()) {
+                out << serializeOrder(temp.front()) << ";";
+                temp.pop();
+            }
+            return out.str();
+        }
+        case 'T': {
+            size_t bar = args.find('|');
+            int n = bar == string::npos ? 3 : atoi(args.c_str() + bar + 1);
+            if (n > TOP_COMPANIONS) return "ERR at most " + to_string(TOP_COMPANIONS) + " companions";
+            out << "OK ";
+            for (auto& c : cooccurrence.topCompanions(args.substr(0, bar), max(n, 1)))
+                out << c.name << ":" << c.count << ";";
+            return out.str();
+        }
+        case 'G': {
+            Restaurant* rest = parseRestaurantIndex(args);
+            if (!rest) return "ERR invalid restaurant";
+            int cartId = groupCarts.open(atoi(args.c_str()) - 1);
+            if (!cartId) return "ERR too many open group carts";
+            out << "OK " << cartId;
+            return out.str();
+        }
+        case 'J': {
+            istringstream ss(args);
+            string cartStr, member, itemsStr, itemPair;
+            getline(ss, cartStr, '|');
+            getline(ss, member, '|');
+            getline(ss, itemsStr);
+            vector<OrderItem> items;
+            istringstream itemsStream(itemsStr);
+            while (getline(itemsStream, itemPair, ',')) {
+                size_t colonPos = itemPair.find(':');
+                if (colonPos == string::npos) continue;
+                items.push_back({itemPair.substr(0, colonPos), atoi(itemPair.c_str() + colonPos + 1)});
+            }
+            // Validate and price the whole request before anything reaches the cart
+            vector<CartLine> lines;
+            string error = priceCartLines(atoi(cartStr.c_str()), items, lines);
+            if (error.empty()) error = addToGroupCart(atoi(cartStr.c_str()), member, lines);
+            if (!error.empty()) return "ERR " + error;
+            return "OK";
+        }
+        case 'K': {
+            size_t bar = args.find('|');
+            GroupCheckout checkout;
+            string error = checkoutGroupCart(atoi(args.c_str()),
+                                             bar == string::npos ? "" : args.substr(bar + 1), checkout);
+            if (!error.empty()) return "ERR " + error;
+            out << "OK " << checkout.placed.order.id << " " << checkout.totalPaise << " ";
+            for (auto& m : checkout.memberSubtotals) out << m.first << ":" << m.second << ",";
+            return out.str();
+        }
+        case 'O': {
+            Order order;
+            if (!orderHistory.readOrder(atoi(args.c_str()), order)) return "ERR no such order";
+            return "OK " + serializeOrder(order);
+        }
+        case 'X': {
+            lock_guard<mutex> lock(engineMutex);
+            out << "OK ";
+            stack<Order> temp = cancelledOrders;
+            while (!temp.empty()) {
+                out << serializeOrder(temp.top()) << ";";
+                temp.pop();
+            }
+            return out.str();
+        }
+        case 'S': {
+            vector<Restaurant*> sortedRestaurants = {&r1, &r2, &r3};
+            heapSort(sortedRestaurants);
+            out << "OK ";
+            for (int i = sortedRestaurants.size() - 1; i >= 0; i--)
+                out << sortedRestaurants[i]->name << ":" << sortedRestaurants[i]->rating << ";";
+            return out.str();
+        }
+        case 'A': {
+            vector<Restaurant*> sortedRestaurants = {&r1, &r2, &r3};
+            sort(sortedRestaurants.begin(), sortedRestaurants.end(), [](Restaurant* a, Restaurant* b) {
+                return a->getAveragePrice() < b->getAveragePrice();
+            });
+            out << "OK ";
+            for (Restaurant* r : sortedRestaurants)
+                out << r->name << ":" << r->getAveragePrice() << ";";
+            return out.str();
+        }
+        default: return "ERR unknown command";
+    }
+}
+
+// Sorted-sample percentile used by the load test report
+double percentile(const vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    size_t idx = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[min(idx, sorted.size() - 1)];
+}
+
+#ifdef __linux__
+// ======= Event-Driven Socket Server (epoll + worker threads) =======
+const size_t MAX_PIPELINE_BATCH = 256;     // requests handed to a worker at once
+const size_t MAX_PENDING_INPUT = 1 << 20;  // bytes read ahead, and the longest request line
+const size_t MAX_PENDING_OUTPUT = 1 << 22; // unsent reply bytes before reading pauses
+
+struct Connection {
+    int fd;
+    unsigned long gen;
+    string in, out;
+    bool busy = false;     // a worker is answering a batch for this connection
+    bool closing = false;  // peer finished sending; close once replies are flushed
+    unsigned events = 0;   // epoll interest currently registered
+};
+
+struct ServerJob {
+    int fd;
+    unsigned long gen;
+    vector<string> requests;
+};
+
+struct ServerReply {
+    int fd;
+    unsigned long gen;
+    string responses;
+};
+
+class WorkerPool {
+private:
+    queue<ServerJob> jobs;
+    mutex jobsMutex;
+    condition_variable jobsReady;
+    vector<ServerReply> replies;
+    mutex repliesMutex;
+    int wakeFd;
+    bool stopping = false;
+    vector<thread> workers;
+    void run();
+public:
+    WorkerPool(int threads, int eventFd);
+    ~WorkerPool();
+    void submit(ServerJob job);
+    void takeReplies(vector<ServerReply>& out);
+};
+
+WorkerPool::WorkerPool(int threads, int eventFd) : wakeFd(eventFd) {
+    for (int i = 0; i < threads; i++) workers.emplace_back(&WorkerPool::run, this);
+}
+WorkerPool::~WorkerPool() {
+    {
+        lock_guard<mutex> lock(jobsMutex);
+        stopping = true;
+    }
+    jobsReady.notify_all();
+    for (auto& t : workers) t.join();
+}
+void WorkerPool::submit(ServerJob job) {
+    {
+        lock_guard<mutex> lock(jobsMutex);
+        jobs.push(move(job));
+    }
+    jobsReady.notify_one();
+}
+void WorkerPool::takeReplies(vector<ServerReply>& out) {
+    lock_guard<mutex> lock(repliesMutex);
+    out.swap(replies);
+}
+void WorkerPool::run() {
+    while (true) {
+        ServerJob job;
+        {
+            unique_lock<mutex> lock(jobsMutex);
+            jobsReady.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (stopping && jobs.empty()) return;
+            job = move(jobs.front());
+            jobs.pop();
+        }
+        ServerReply reply{job.fd, job.gen, ""};
+        for (const string& req : job.requests) {
+            reply.responses += handleRequest(req);
+            reply.responses += '\n';
+        }
+        {
+            lock_guard<mutex> lock(repliesMutex);
+            replies.push_back(move(reply));
+        }
+        uint64_t one = 1;
+        ssize_t ignored = write(wakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+}
+
+void raiseFileLimit() {
+    struct rlimit lim;
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < lim.rlim_max) {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+}
+
+// Endpoints are "unix:/path/to.sock" or "tcp:<port>" (loopback only)
+int openListener(const string& endpoint) {
+    int fd;
+    if (endpoint.rfind("unix:", 0) == 0) {
+        string path = endpoint.substr(5);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) { close(fd); return -1; }
+        strcpy(addr.sun_path, path.c_str());
+        unlink(path.c_str());
+        if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0) { close(fd); return -1; }
+    } else if (endpoint.rfind("tcp:", 0) == 0) {
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)atoi(endpoint.c_str() + 4));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0) { close(fd); return -1; }
+    } else {
+        return -1;
+    }
+    if (listen(fd, SOMAXCONN) < 0) { close(fd); return -1; }
+    return fd;
+}
+
+int connectEndpoint(const string& endpoint) {
+    int fd;
+    if (endpoint.rfind("unix:", 0) == 0) {
+        string path = endpoint.substr(5);
+        fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) { close(fd); return -1; }
+        strcpy(addr.sun_path, path.c_str());
+        if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) { close(fd); return -1; }
+    } else if (endpoint.rfind("tcp:", 0) == 0) {
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)atoi(endpoint.c_str() + 4));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) { close(fd); return -1; }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    } else {
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+class SocketServer {
+private:
+    int epollFd, listenFd, wakeFd;
+    int spareFd; // released to accept-and-close a client when out of descriptors
+    unordered_map<int, Connection> conns;
+    unsigned long nextGen = 1;
+    WorkerPool* pool;
+    void acceptAll();
+    void readFrom(Connection& c);
+    void dispatch(Connection& c);
+    void flush(Connection& c);
+    void updateInterest(Connection& c);
+    void closeConnection(int fd);
+    void drainReplies();
+public:
+    SocketServer(int listener, int workers);
+    ~SocketServer();
+    void run();
+};
+
+SocketServer::SocketServer(int listener, int workers) : listenFd(listener) {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    spareFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = listenFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+    ev.data.fd = wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+    pool = new WorkerPool(workers, wakeFd);
+}
+SocketServer::~SocketServer() {
+    delete pool;
+    for (auto& entry : conns) close(entry.first);
+    close(wakeFd);
+    close(epollFd);
+    if (spareFd >= 0) close(spareFd);
+}
+
+void SocketServer::acceptAll() {
+    while (true) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if ((errno == EMFILE || errno == ENFILE) && spareFd >= 0) {
+                // Shed the pending client instead of leaving it queued on the
+                // level-triggered listener, which would make epoll_wait spin
+                close(spareFd);
+                int shed = accept(listenFd, nullptr, nullptr);
+                if (shed >= 0) close(shed);
+                spareFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                if (shed < 0) return; // backlog drained
+                continue;
+            }
+            return; // EAGAIN
+        }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        Connection& c = conns[fd];
+        c = Connection();
+        c.fd = fd;
+        c.gen = nextGen++;
+        c.events = EPOLLIN | EPOLLRDHUP;
+        epoll_event ev{};
+        ev.events = c.events;
+        ev.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+    }
+}
+
+void SocketServer::closeConnection(int fd) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    conns.erase(fd);
+}
+
+void SocketServer::readFrom(Connection& c) {
+    char buf[16384];
+    while (c.in.size() <= MAX_PENDING_INPUT) {
+        ssize_t n = read(c.fd, buf, sizeof(buf));
+        if (n > 0) {
+            c.in.append(buf, n);
+            continue;
+        }
+        if (n == 0) c.closing = true;
+        else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) c.closing = true;
+        else if (errno == EINTR) continue;
+        break;
+    }
+}
+
+// Hands every complete line buffered for this connection to one worker, so
+// pipelined requests are processed in order and replies come back in order.
+void SocketServer::dispatch(Connection& c) {
+    size_t firstLine = c.in.find('\n');
+    if (firstLine == string::npos ? c.in.size() > MAX_PENDING_INPUT : firstLine > MAX_PENDING_INPUT) {
+        if (c.busy) return; // rejected once the batch in flight has replied, keeping replies in order
+        c.in.clear();
+        c.out += "ERR request too long\n";
+        c.closing = true;
+        flush(c);
+        return;
+    }
+    if (c.busy || c.out.size() > MAX_PENDING_OUTPUT) return;
+    size_t start = 0, nl;
+    ServerJob job{c.fd, c.gen, {}};
+    while (job.requests.size() < MAX_PIPELINE_BATCH &&
+           (nl = c.in.find('\n', start)) != string::npos) {
+        size_t end = nl;
+        if (end > start && c.in[end - 1] == '\r') end--;
+        job.requests.push_back(c.in.substr(start, end - start));
+        start = nl + 1;
+    }
+    c.in.erase(0, start);
+    if (!job.requests.empty()) {
+        c.busy = true;
+        pool->submit(move(job));
+    }
+}
+
+void SocketServer::flush(Connection& c) {
+    size_t sent = 0;
+    while (sent < c.out.size()) {
+        ssize_t n = send(c.fd, c.out.data() + sent, c.out.size() - sent, MSG_NOSIGNAL);
+        if (n > 0) { sent += n; continue; }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        c.out.clear(); // peer is gone
+        c.closing = true;
+        sent = 0;
+        break;
+    }
+    c.out.erase(0, sent);
+}
+
+// Input is only polled while the connection can take more work: not while a
+// batch is in flight, replies are backed up or the read-ahead is full. A client
+// that pipelines without reading is then held back by its own socket buffers.
+void SocketServer::updateInterest(Connection& c) {
+    bool reading = !c.closing && !c.busy && c.out.size() <= MAX_PENDING_OUTPUT &&
+                   c.in.size() <= MAX_PENDING_INPUT;
+    unsigned events = (reading ? (EPOLLIN | EPOLLRDHUP) : 0u) | (c.out.empty() ? 0u : EPOLLOUT);
+    if (events == c.events) return;
+    c.events = events;
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = c.fd;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, c.fd, &ev);
+}
+
+void SocketServer::drainReplies() {
+    uint64_t count;
+    ssize_t ignored = read(wakeFd, &count, sizeof(count));
+    (void)ignored;
+    vector<ServerReply> replies;
+    pool->takeReplies(replies);
+    for (auto& reply : replies) {
+        auto it = conns.find(reply.fd);
+        if (it == conns.end() || it->second.gen != reply.gen) continue; // closed meanwhile
+        Connection& c = it->second;
+        c.busy = false;
+        c.out += reply.responses;
+        flush(c);
+        dispatch(c);
+        if (c.closing && !c.busy && c.out.empty()) closeConnection(c.fd);
+        else updateInterest(c);
+    }
+}
+
+void SocketServer::run() {
+    vector<epoll_event> events(1024);
+    while (true) {
+        int n = epoll_wait(epollFd, events.data(), events.size(), -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;
+        }
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == listenFd) { acceptAll(); continue; }
+            if (fd == wakeFd) { drainReplies(); continue; }
+            auto it = conns.find(fd);
+            if (it == conns.end()) continue;
+            Connection& c = it->second;
+            if (events[i].events & EPOLLERR) { closeConnection(fd); continue; }
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+                readFrom(c);
+                dispatch(c);
+            }
+            if (events[i].events & EPOLLOUT) {
+                flush(c);
+                dispatch(c); // replies drained below the high-water mark
+            }
+            if (c.closing && !c.busy && c.out.empty()) closeConnection(fd);
+            else updateInterest(c);
+        }
+    }
+}
+
+int runServer(const string& endpoint, int workers) {
+    signal(SIGPIPE, SIG_IGN);
+    raiseFileLimit();
+    int listener = openListener(endpoint);
+    if (listener < 0) {
+        cout << "Could not listen on " << endpoint << " (use unix:/path or tcp:<port>)\n";
+        return 1;
+    }
+    cout << "Food Delivery server listening on " << endpoint << " with " << workers << " workers\n";
+    SocketServer server(listener, workers);
+    server.run();
+    close(listener);
+    return 0;
+}
+
+// ======= Load Test Client =======
+struct LoadConnection {
+    int fd;
+    int sent = 0, received = 0;
+    string in, out;
+    deque<chrono::steady_clock::time_point> inFlight;
+};
+
+string loadTestRequest(int connIdx, int reqIdx, bool writes) {
+    if (writes && reqIdx % 50 == 49)
+        return "U 1|Breakfast|Idli|" + to_string(40 + reqIdx % 7);
+    if (writes && reqIdx % 10 == 9)
+        return "P loadtest-" + to_string(connIdx) + "|" + to_string(reqIdx % 3 + 1) + "|" +
+               (reqIdx % 3 == 0 ? "Idli" : reqIdx % 3 == 1 ? "Poori" : "Plain Dosa") + ":1,";
+    switch (reqIdx % 4) {
+        case 0: return "R";
+        case 1: return "M " + to_string(reqIdx % 3 + 1);
+        case 2: return "S";
+        default: return "A";
+    }
+}
+
+int runLoadTest(const string& endpoint, int connections, int requestsPerConn, int depth, bool writes) {
+    signal(SIGPIPE, SIG_IGN);
+    raiseFileLimit();
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    vector<LoadConnection> conns(connections);
+    for (int i = 0; i < connections; i++) {
+        conns[i].fd = connectEndpoint(endpoint);
+        if (conns[i].fd < 0) {
+            cout << "Connection " << i << " to " << endpoint << " failed: " << strerror(errno) << "\n";
+            for (int j = 0; j < i; j++) close(conns[j].fd);
+            close(epollFd);
+            return 1;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u32 = i;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, conns[i].fd, &ev);
+    }
+
+    vector<double> latenciesUs;
+    latenciesUs.reserve((size_t)connections * requestsPerConn);
+    long errors = 0;
+    int finished = 0;
+    auto sendMore = [&](int i) {
+        LoadConnection& c = conns[i];
+        auto now = chrono::steady_clock::now();
+        while (c.sent < requestsPerConn && (int)c.inFlight.size() < depth) {
+            c.out += loadTestRequest(i, c.sent++, writes);
+            c.out += '\n';
+            c.inFlight.push_back(now);
+        }
+        size_t sent = 0;
+        while (sent < c.out.size()) {
+            ssize_t n = send(c.fd, c.out.data() + sent, c.out.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) break;
+            sent += n;
+        }
+        c.out.erase(0, sent);
+        epoll_event ev{};
+        ev.events = EPOLLIN | (c.out.empty() ? 0u : EPOLLOUT);
+        ev.data.u32 = i;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, c.fd, &ev);
+    };
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < connections; i++) sendMore(i);
+    vector<epoll_event> events(1024);
+    char buf[16384];
+    while (finished < connections) {
+        int n = epoll_wait(epollFd, events.data(), events.size(), 10000);
+        if (n == 0) {
+            cout << "Load test stalled: no replies for 10s\n";
+            break;
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int e = 0; e < n; e++) {
+            int i = events[e].data.u32;
+            LoadConnection& c = conns[i];
+            bool peerClosed = false;
+            while (true) {
+                ssize_t r = read(c.fd, buf, sizeof(buf));
+                if (r > 0) { c.in.append(buf, r); continue; }
+                if (r == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) peerClosed = true;
+                break;
+            }
+            auto now = chrono::steady_clock::now();
+            size_t pos = 0, nl;
+            while ((nl = c.in.find('\n', pos)) != string::npos && !c.inFlight.empty()) {
+                if (c.in.compare(pos, 3, "ERR") == 0) errors++;
+                latenciesUs.push_back(chrono::duration<double, micro>(now - c.inFlight.front()).count());
+                c.inFlight.pop_front();
+                c.received++;
+                pos = nl + 1;
+            }
+            c.in.erase(0, pos);
+            if (c.received == requestsPerConn || peerClosed) {
+                if (peerClosed && c.received < requestsPerConn) errors += requestsPerConn - c.received;
+                epoll_ctl(epollFd, EPOLL_CTL_DEL, c.fd, nullptr);
+                close(c.fd);
+                c.fd = -1;
+                finished++;
+            } else {
+                sendMore(i);
+            }
+        }
+    }
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    for (auto& c : conns) if (c.fd >= 0) close(c.fd);
+    close(epollFd);
+
+    sort(latenciesUs.begin(), latenciesUs.end());
+    cout << "\n--- Load Test Report ---\n";
+    cout << "Connections: " << connections << ", pipeline depth: " << depth
+         << ", mix: " << (writes ? "read/write" : "read-only") << "\n";
+    cout << "Completed requests: " << latenciesUs.size() << " (" << errors << " errors) in "
+         << elapsed << "s\n";
+    cout << "Throughput: " << (elapsed > 0 ? latenciesUs.size() / elapsed : 0) << " req/s\n";
+    cout << "Latency (us): p50 " << percentile(latenciesUs, 0.50)
+         << ", p99 " << percentile(latenciesUs, 0.99)
+         << ", p99.9 " << percentile(latenciesUs, 0.999)
+         << ", max " << (latenciesUs.empty() ? 0 : latenciesUs.back()) << "\n";
+    return errors ? 1 : 0;
+}
+#else
+int runServer(const string& endpoint, int workers) {
+    cout << "Server mode requires Linux (epoll).\n";
+    return 1;
+}
+int runLoadTest(const string& endpoint, int connections, int requestsPerConn, int depth, bool writes) {
+    cout << "Load test mode requires Linux (epoll).\n";
+    return 1;
+}
+#endif
+
+// ======= Dinner-Rush Simulator =======
+// Replays a seeded 6 PM - midnight evening against the order engine in virtual
+// time: Poisson arrivals following a dinner curve, a promo stampede at 9 PM and
+// cancellation storms. Arrivals are dispatched to concurrent workers; latency
+// runs from each event's scheduled arrival to completion, so bursts that
+// outpace the workers show up as queueing delay. Engine calls are applied in
+// event order, so a seed gives the same outcomes for any number of workers.
+struct SimEvent {
+    time_t at;
+    bool cancel;
+    // Basket drawn up front from the seed so every run replays the same orders
+    int restaurant;
+    vector<pair<MenuItem*, int>> basket;
+    string customerName;
+};
+
+struct SimResult {
+    double latencyUs = 0;
+    bool ok = false, closingDiscount = false, twentyPercent = false, offerWinner = false;
+    double fullPrice = 0, charged = 0;
+};
+
+struct SimHourStats {
+    int orders = 0, cancels = 0, closingDiscount = 0, twentyPercent = 0, offerWinners = 0;
+    double fullPrice = 0, charged = 0;
+};
+
+// Virtual timestamp at the start of the given local hour (as getHourAt sees it)
+time_t virtualTimeAtHour(int hour) {
+    time_t base = 1704067200; // fixed day so runs are reproducible
+    struct tm tmv = localTimeOf(base + 19800);
+    base -= tmv.tm_min * 60 + tmv.tm_sec;
+    return base + ((hour - tmv.tm_hour + 24) % 24) * 3600;
+}
+
+// Appends Poisson arrivals at ratePerHour over [from, from + seconds)
+void addPoissonArrivals(vector<SimEvent>& events, mt19937_64& rng, time_t from,
+                        double seconds, double ratePerHour, bool cancel) {
+    if (ratePerHour <= 0) return;
+    exponential_distribution<double> gap(ratePerHour / 3600.0);
+    for (double t = gap(rng); t < seconds; t += gap(rng))
+        events.push_back({from + (time_t)t, cancel, 0, {}, ""});
+}
+
+// Lets workers run events concurrently while the engine sees them in order:
+// event i enters the engine only after event i - 1 has left it
+class SimSequencer {
+private:
+    mutex lock;
+    condition_variable turnChanged;
+    size_t turn = 0;
+public:
+    void wait(size_t index) {
+        unique_lock<mutex> guard(lock);
+        turnChanged.wait(guard, [&] { return turn == index; });
+    }
+    void advance() {
+        {
+            lock_guard<mutex> guard(lock);
+            turn++;
+        }
+        turnChanged.notify_all();
+    }
+};
+
+// Runs one event on the calling worker and records its outcome
+void runSimEvent(const SimEvent& ev, size_t index, SimSequencer& sequencer,
+                 VirtualClock& clock, SimResult& result) {
+    clock.set(ev.at);
+    if (ev.cancel) {
+        Order cancelled;
+        sequencer.wait(index);
+        result.ok = popLatestOrder(cancelled);
+        sequencer.advance();
+        return;
+    }
+    bool discountActive = isClosingDiscountTime();
+    bool twentyActive = !discountActive && isTwentyPercentOfferTime();
+    vector<OrderItem> itemsOrdered;
+    double totalPrice = 0.0, fullPrice = 0.0;
+    for (auto& b : ev.basket) {
+        itemsOrdered.push_back({b.first->name, b.second});
+        totalPrice += applyTimeDiscount(b.first->price, discountActive) * b.second;
+        fullPrice += b.first->price * b.second;
+    }
+    sequencer.wait(index);
+    PlacedOrder placed = submitOrder(ev.customerName, restaurants[ev.restaurant], itemsOrdered, totalPrice);
+    sequencer.advance();
+    result.ok = true;
+    result.closingDiscount = discountActive;
+    result.twentyPercent = twentyActive;
+    result.offerWinner = placed.offerWinner;
+    result.fullPrice = fullPrice;
+    result.charged = totalPrice;
+}
+
+int runSimulation(unsigned long long seed, double scale, double speedup, int workers) {
+    mt19937_64 rng(seed);
+    time_t simStart = virtualTimeAtHour(18);
+    VirtualClock clock(simStart);
+    activeClock = &clock;
+    persistOrders = false;
+    previousOrders = queue<Order>();
+    cancelledOrders = stack<Order>();
+    windowedOffers.clear();
+    customerOrderCount.clear();
+    heapSize = 0;
+    cooccurrence.clear();
+    orderCounter = 1;
+
+    // Orders per hour from 6 PM to midnight, then the bursts on top
+    const double dinnerCurve[6] = {120, 300, 520, 600, 380, 200};
+    vector<SimEvent> events;
+    for (int h = 0; h < 6; h++) {
+        addPoissonArrivals(events, rng, simStart + h * 3600, 3600, dinnerCurve[h] * scale, false);
+        addPoissonArrivals(events, rng, simStart + h * 3600, 3600, dinnerCurve[h] * scale * 0.03, true);
+    }
+    // Promo stampede: ~400 extra orders in the first 3 minutes of the 9 PM offer
+    addPoissonArrivals(events, rng, virtualTimeAtHour(PROMO_START_HOUR), 180, 400 * scale * 20, false);
+    // Two cancellation storms of ~40 cancels in 90s, e.g. a kitchen outage mid-service
+    uniform_int_distribution<int> stormMinute(0, 5 * 60);
+    for (int s = 0; s < 2; s++)
+        addPoissonArrivals(events, rng, simStart + stormMinute(rng) * 60, 90, 40 * scale * 40, true);
+    stable_sort(events.begin(), events.end(), [](const SimEvent& a, const SimEvent& b) {
+        return a.at < b.at;
+    });
+
+    EpochGuard menuGuard;
+    vector<vector<MenuItem*>> restaurantItems(3);
+    for (int r = 0; r < 3; r++)
+        for (auto& entry : restaurants[r]->snapshot()->categoryMenus)
+            for (MenuItem* item = entry.second.getItem(1); item; item = item->next)
+                restaurantItems[r].push_back(item);
+    uniform_int_distribution<int> pickRestaurant(0, 2), pickItemCount(1, 4), pickQty(1, 3);
+    uniform_int_distribution<int> pickCustomer(1, 2000);
+    for (SimEvent& ev : events) {
+        if (ev.cancel) continue;
+        ev.restaurant = pickRestaurant(rng);
+        int itemCount = pickItemCount(rng);
+        uniform_int_distribution<int> pickItem(0, restaurantItems[ev.restaurant].size() - 1);
+        for (int i = 0; i < itemCount; i++)
+            ev.basket.push_back({restaurantItems[ev.restaurant][pickItem(rng)], pickQty(rng)});
+        ev.customerName = "customer-" + to_string(pickCustomer(rng));
+    }
+
+    // Workers claim events in arrival order and wait for each one's scheduled
+    // wall time, so a burst that outnumbers them queues behind busy workers
+    vector<SimResult> results(events.size());
+    atomic<size_t> nextEvent(0);
+    SimSequencer sequencer;
+    auto realStart = chrono::steady_clock::now();
+    auto worker = [&]() {
+        for (size_t i = nextEvent++; i < events.size(); i = nextEvent++) {
+            auto scheduled = chrono::steady_clock::now();
+            if (speedup > 0) {
+                scheduled = realStart + chrono::duration_cast<chrono::steady_clock::duration>(
+                    chrono::duration<double>((events[i].at - simStart) / speedup));
+                this_thread::sleep_until(scheduled);
+            }
+            runSimEvent(events[i], i, sequencer, clock, results[i]);
+            results[i].latencyUs = chrono::duration<double, micro>(chrono::steady_clock::now() - scheduled).count();
+        }
+    };
+    vector<thread> threads;
+    for (int w = 1; w < workers; w++) threads.emplace_back(worker);
+    worker();
+    for (thread& t : threads) t.join();
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - realStart).count();
+    activeClock = &systemClock;
+
+    vector<double> orderLatencyUs, cancelLatencyUs;
+    SimHourStats hourStats[24];
+    int failedCancels = 0;
+    for (size_t i = 0; i < events.size(); i++) {
+        const SimResult& res = results[i];
+        SimHourStats& stats = hourStats[getHourAt(events[i].at)];
+        if (events[i].cancel) {
+            cancelLatencyUs.push_back(res.latencyUs);
+            if (res.ok) stats.cancels++;
+            else failedCancels++;
+            continue;
+        }
+        orderLatencyUs.push_back(res.latencyUs);
+        stats.orders++;
+        if (res.closingDiscount) stats.closingDiscount++;
+        if (res.twentyPercent) stats.twentyPercent++;
+        if (res.offerWinner) stats.offerWinners++;
+        stats.fullPrice += res.fullPrice;
+        stats.charged += res.charged;
+    }
+
+    sort(orderLatencyUs.begin(), orderLatencyUs.end());
+    sort(cancelLatencyUs.begin(), cancelLatencyUs.end());
+    cout << "\n--- Dinner Rush Simulation (seed " << seed << ", scale " << scale << ", "
+         << workers << " workers, speedup " << speedup << ") ---\n";
+    cout << "Events: " << events.size() << " over 6 virtual hours in " << elapsed << "s ("
+         << (elapsed > 0 ? events.size() / elapsed : 0) << " events/s)\n";
+    cout << "Latency is " << (speedup > 0 ? "scheduled arrival to completion" : "service time only (no arrival pacing)") << "\n";
+    cout << "Order latency (us): p50 " << percentile(orderLatencyUs, 0.50)
+         << ", p99 " << percentile(orderLatencyUs, 0.99)
+         << ", p99.9 " << percentile(orderLatencyUs, 0.999)
+         << ", max " << (orderLatencyUs.empty() ? 0 : orderLatencyUs.back()) << "\n";
+    cout << "Cancel latency (us): p50 " << percentile(cancelLatencyUs, 0.50)
+         << ", p99 " << percentile(cancelLatencyUs, 0.99)
+         << ", p99.9 " << percentile(cancelLatencyUs, 0.999)
+         << ", max " << (cancelLatencyUs.empty() ? 0 : cancelLatencyUs.back()) << "\n";
+    cout << "Hour  Orders  Cancels  20%Off  50%Off  Top50  Discount(Rs)\n";
+    for (int h = 18; h < 24; h++) {
+        SimHourStats& st = hourStats[h];
+        cout << h << ":00 " << st.orders << "  " << st.cancels << "  " << st.twentyPercent << "  "
+             << st.closingDiscount << "  " << st.offerWinners << "  " << (st.fullPrice - st.charged) << "\n";
+    }
+    cout << "Cancellations with nothing to cancel: " << failedCancels << "\n";
+    return 0;
+}
+
 // ======= Main Menu Driver =======
-int main() {
+// Usage:
+//   main                                           interactive console
+//   main serve <unix:/path|tcp:port> [workers]     socket server
+//   main loadtest <endpoint> [conns] [reqs/conn] [pipeline depth] [ro|rw]
+//   main simulate [seed] [scale] [speedup, 0 = as fast as possible] [workers]
+int main(int argc, char* argv[]) {
     initializeMenus();
-    loadOrdersFromFile("orders.txt", previousOrders);
-    loadCancelledOrdersFromFile("cancelled_orders.txt", cancelledOrders);
+    orderHistory.migrateLegacy("orders.txt", "cancelled_orders.txt");
+    orderHistory.load(previousOrders, cancelledOrders);
+    orderHistory.compactAll();
+    {
+        vector<Order> history;
+        for (queue<Order> temp = previousOrders; !temp.empty(); temp.pop()) history.push_back(temp.front());
+        cooccurrence.bulkBuild(history);
+    }
 
     // Determine orderCounter (restore correct value)
     if (!previousOrders.empty()) {
@@ -754,8 +2981,33 @@ int main() {
         }
     }
 
+    // Profiles are shared by the console and the server's profile commands
+    profileStore.load();
+
+    string mode = argc > 1 ? argv[1] : "";
+    if (mode == "serve") {
+        int workers = argc > 3 ? atoi(argv[3]) : (int)thread::hardware_concurrency();
+        return runServer(argc > 2 ? argv[2] : "unix:/tmp/food_delivery.sock", max(workers, 1));
+    }
+    if (mode == "loadtest") {
+        string endpoint = argc > 2 ? argv[2] : "unix:/tmp/food_delivery.sock";
+        int conns = argc > 3 ? atoi(argv[3]) : 100;
+        int reqs = argc > 4 ? atoi(argv[4]) : 1000;
+        int depth = argc > 5 ? atoi(argv[5]) : 16;
+        bool writes = argc > 6 && string(argv[6]) == "rw";
+        return runLoadTest(endpoint, max(conns, 1), max(reqs, 1), max(depth, 1), writes);
+    }
+
+    if (mode == "simulate") {
+        unsigned long long seed = argc > 2 ? strtoull(argv[2], nullptr, 10) : 42;
+        double scale = argc > 3 ? atof(argv[3]) : 1.0;
+        double speedup = argc > 4 ? atof(argv[4]) : 3600.0;
+        int workers = argc > 5 ? atoi(argv[5]) : (int)thread::hardware_concurrency();
+        return runSimulation(seed, scale > 0 ? scale : 1.0, max(speedup, 0.0), max(workers, 1));
+    }
+
     cout << "Welcome to the Food Delivery System!\n";
-    userProfile.inputProfile();
+    loginProfile();
     int choice;
     do {
         cout << "\n==== Food Delivery System ====\n";
@@ -768,6 +3020,9 @@ int main() {
         cout << "7. Show restaurants sorted by average price\n";
         cout << "8. Show time-windowed offer winners (9–11 PM)\n";
         cout << "9. View Health Profile\n";
+        cout << "10. Update allergies\n";
+        cout << "11. Add or reprice a menu item (admin)\n";
+        cout << "12. Start a group order (shared cart)\n";
         cout << "0. Exit\n";
         cout << "Enter your choice: ";
         cin >> choice;
@@ -802,6 +3057,38 @@ int main() {
                 break;
             }
             case 9: userProfile.viewProfile(); break;
+            case 10:
+                cin.ignore(numeric_limits<streamsize>::max(), '\n');
+                userProfile.inputAllergies();
+                profileStore.save(userProfile);
+                cout << "Health profile updated.\n";
+                break;
+            case 11: {
+                viewAllRestaurants();
+                cout << "Select a restaurant (1-3): ";
+                int rInd;
+                cin >> rInd;
+                if (rInd < 1 || rInd > 3) {
+                    cout << "Invalid restaurant selection.\n";
+                    break;
+                }
+                string category, itemName;
+                double price;
+                cout << "Category: ";
+                cin >> ws; getline(cin, category);
+                cout << "Item name: ";
+                getline(cin, itemName);
+                cout << "Price: ";
+                cin >> price;
+                if (category.empty() || itemName.empty() || price <= 0) {
+                    cout << "Invalid menu item.\n";
+                    break;
+                }
+                restaurants[rInd - 1]->addMenuItemToCategory(category, itemName, price);
+                cout << "Menu updated.\n";
+                break;
+            }
+            case 12: placeGroupOrder(); break;
             case 0: cout << "Exiting...\n"; break;
             default: cout << "Invalid choice.\n"; break;
         }